@@ -11,8 +11,8 @@
 #define PIT_PORT_CONTROL          0x43                /* Control port. */
 #define PIT_PORT_COUNTER(CHANNEL) (0x40 + (CHANNEL))  /* Counter port. */
 
-/* PIT cycles per second. */
-#define PIT_HZ 1193180
+/* Counter value each channel reloads with, 0 if unconfigured. */
+static unsigned reload_counts[3];
 
 /* Configure the given CHANNEL in the PIT.  In a PC, the PIT's
    three output channels are hooked up like this:
@@ -79,5 +79,65 @@ pit_configure_channel (int channel, int mode, int frequency)
   outb (PIT_PORT_CONTROL, (channel << 6) | 0x30 | (mode << 1));
   outb (PIT_PORT_COUNTER (channel), count);
   outb (PIT_PORT_COUNTER (channel), count >> 8);
+  reload_counts[channel] = count != 0 ? count : 65536;
   intr_set_level (old_level);
 }
+
+/* Starts CHANNEL counting down CYCLES PIT cycles, between 2 and
+   65535, in mode 0: its output rises once when the count runs
+   out, so channel 0 raises a single interrupt.  Calling
+   pit_configure_channel() afterward returns to periodic
+   operation. */
+void
+pit_start_oneshot (int channel, unsigned cycles)
+{
+  enum intr_level old_level;
+
+  ASSERT (channel == 0 || channel == 2);
+  ASSERT (cycles >= 2 && cycles <= 0xffff);
+
+  old_level = intr_disable ();
+  outb (PIT_PORT_CONTROL, (channel << 6) | 0x30);
+  outb (PIT_PORT_COUNTER (channel), cycles);
+  outb (PIT_PORT_COUNTER (channel), cycles >> 8);
+  reload_counts[channel] = cycles;
+  intr_set_level (old_level);
+}
+
+/* Returns CHANNEL's current count.  In mode 0 the count keeps
+   going down past 0, wrapping to 0xffff. */
+unsigned
+pit_read_counter (int channel)
+{
+  enum intr_level old_level;
+  unsigned count;
+
+  ASSERT (channel == 0 || channel == 2);
+
+  /* Latch the counter so that the two byte reads agree. */
+  old_level = intr_disable ();
+  outb (PIT_PORT_CONTROL, channel << 6);
+  count = inb (PIT_PORT_COUNTER (channel));
+  count |= inb (PIT_PORT_COUNTER (channel)) << 8;
+  intr_set_level (old_level);
+  return count;
+}
+
+/* Returns the number of PIT cycles since CHANNEL last reloaded
+   its counter, that is, how far it is into the current period.
+   Returns 0 if CHANNEL has not been configured. */
+unsigned
+pit_cycles_elapsed (int channel)
+{
+  unsigned count;
+
+  ASSERT (channel == 0 || channel == 2);
+
+  if (reload_counts[channel] == 0)
+    return 0;
+
+  count = pit_read_counter (channel);
+  if (count == 0 || count > reload_counts[channel])
+    count = reload_counts[channel];
+  return reload_counts[channel] - count;
+}
@@ -3,6 +3,12 @@
 
 #include <stdint.h>
 
+/* PIT cycles per second. */
+#define PIT_HZ 1193180
+
 void pit_configure_channel (int channel, int mode, int frequency);
+void pit_start_oneshot (int channel, unsigned cycles);
+unsigned pit_read_counter (int channel);
+unsigned pit_cycles_elapsed (int channel);
 
 #endif /* devices/pit.h */
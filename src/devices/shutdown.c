@@ -8,11 +8,15 @@
 #include "threads/thread.h"
 #ifdef USERPROG
 #include "userprog/exception.h"
+#include "userprog/process.h"
 #endif
 #ifdef FILESYS
 #include "devices/block.h"
 #include "filesys/filesys.h"
 #endif
+#ifdef VM
+#include "vm/swap.h"
+#endif
 
 /* Keyboard control register port. */
 #define CONTROL_REG 0x64
@@ -127,5 +131,9 @@ print_stats (void)
   kbd_print_stats ();
 #ifdef USERPROG
   exception_print_stats ();
+  process_print_stats ();
+#endif
+#ifdef VM
+  swap_print_stats ();
 #endif
 }
@@ -10,21 +10,84 @@
   
 /* See [8254] for hardware details of the 8254 timer chip. */
 
-#if TIMER_FREQ < 19
+#if TIMER_FREQ_DEFAULT < TIMER_FREQ_MIN
 #error 8254 timer requires TIMER_FREQ >= 19
 #endif
-#if TIMER_FREQ > 1000
+#if TIMER_FREQ_DEFAULT > TIMER_FREQ_MAX
 #error TIMER_FREQ <= 1000 recommended
 #endif
 
+int timer_freq = TIMER_FREQ_DEFAULT;
+
 /* Number of timer ticks since OS booted. */
 static int64_t ticks;
 
+/* PIT cycles per tick. */
+static unsigned tick_cycles;
+
+/* Tickless idle.
+
+   When only the idle thread can run, timer_idle() replaces the
+   periodic interrupt by a one-shot interrupt at the next tick
+   when something is due: a sleeper, a level 0 timeout, a wheel
+   cascade, or, under the 4.4BSD scheduler, the once-a-second
+   load average update.  The PIT's 16-bit counter bounds how far
+   ahead that can be (5 ticks at 100 Hz).  The interrupt then
+   advances ticks by the whole interval.  If something else
+   wakes a thread first, timer_idle_exit() credits the ticks
+   that have passed and finishes the partial one with another
+   one-shot, whose interrupt restarts the periodic one.  Either
+   way, the idle thread is charged for the ticks that passed
+   without an interrupt. */
+bool timer_tickless;
+static bool oneshot_idle;        /* One-shot armed by timer_idle()? */
+static int oneshot_ticks;        /* Ticks the one-shot covers, or 0. */
+static unsigned oneshot_cycles;  /* Its PIT count. */
+static unsigned oneshot_offset;  /* Cycles into a tick it started. */
+static long long timer_interrupts; /* Timer interrupts taken. */
+
+/* Threads blocked in timer_sleep(), in order of wakeup_tick.
+   Shared with the timer interrupt, so only touched with
+   interrupts off. */
+static struct list sleep_list;
+
+/* Hierarchical timer wheel for timer_add().
+
+   Level L has WHEEL_SIZE slots, each covering
+   WHEEL_SIZE**L ticks.  A timeout due in fewer than
+   WHEEL_SIZE**(L+1) ticks sits on level L in the slot picked by
+   bits L*WHEEL_BITS and up of its expiry tick.  Every tick runs
+   one level 0 slot; whenever the level 0 index wraps, one slot
+   of the next level up is cascaded down, and so on.  Insert and
+   cancel are O(1), and each timeout is moved at most
+   WHEEL_LEVELS - 1 times before it runs.  Timeouts further out
+   than the top level can reach are parked in its last slot and
+   re-placed as they cascade.
+
+   Due timeouts move to expired_list in the timer interrupt and
+   their functions are called afterward by a kernel thread, much
+   like a softirq, so that they can take locks. */
+#define WHEEL_BITS 6
+#define WHEEL_SIZE (1 << WHEEL_BITS)
+#define WHEEL_MASK (WHEEL_SIZE - 1)
+#define WHEEL_LEVELS 4
+#define WHEEL_SPAN (1LL << (WHEEL_BITS * WHEEL_LEVELS))
+
+static struct list wheel[WHEEL_LEVELS][WHEEL_SIZE];
+static int64_t wheel_ticks;          /* Next tick the wheel will run. */
+static struct list expired_list;     /* Due, waiting for softirq. */
+static struct semaphore softirq_sema; /* Up when expired_list fills. */
+
 /* Number of loops per timer tick.
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
 static intr_handler_func timer_interrupt;
+static bool wakeup_less (const struct list_elem *, const struct list_elem *,
+                         void *aux);
+static void wheel_insert (struct timeout *);
+static void wheel_advance (void);
+static thread_func timer_softirq;
 static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
@@ -35,10 +98,29 @@ static void real_time_delay (int64_t num, int32_t denom);
 void
 timer_init (void) 
 {
+  int level, slot;
+
+  list_init (&sleep_list);
+  for (level = 0; level < WHEEL_LEVELS; level++)
+    for (slot = 0; slot < WHEEL_SIZE; slot++)
+      list_init (&wheel[level][slot]);
+  wheel_ticks = ticks + 1;
+  list_init (&expired_list);
+  sema_init (&softirq_sema, 0);
+
+  tick_cycles = (PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ;
   pit_configure_channel (0, 2, TIMER_FREQ);
   intr_register_ext (0x20, timer_interrupt, "8254 Timer");
 }
 
+/* Starts the thread that runs expired timeouts.  Must be called
+   after thread_start(). */
+void
+timer_init_softirq (void)
+{
+  thread_create ("timer-softirq", PRI_MAX, timer_softirq, NULL);
+}
+
 /* Calibrates loops_per_tick, used to implement brief delays. */
 void
 timer_calibrate (void) 
@@ -84,16 +166,134 @@ timer_elapsed (int64_t then)
   return timer_ticks () - then;
 }
 
+/* Returns the number of microseconds since the OS booted, to
+   within a few PIT cycles, by adding the PIT's progress through
+   the current tick to the tick count.  Never goes backward, even
+   if the PIT wraps before its interrupt has been handled. */
+int64_t
+timer_usecs (void)
+{
+  static int64_t last_usecs;
+  enum intr_level old_level;
+  unsigned cycles;
+  int64_t usecs;
+
+  old_level = intr_disable ();
+  cycles = pit_cycles_elapsed (0);
+  if (oneshot_ticks != 0)
+    cycles += oneshot_offset;
+  usecs = ticks * 1000000 / TIMER_FREQ + (int64_t) cycles * 1000000 / PIT_HZ;
+  if (usecs < last_usecs)
+    usecs = last_usecs;
+  last_usecs = usecs;
+  intr_set_level (old_level);
+  return usecs;
+}
+
+/* Called by the idle thread, with interrupts off, just before
+   it halts.  In tickless mode, stops the periodic interrupt until
+   the next tick at which anything is due. */
+void
+timer_idle (void)
+{
+  int64_t limit;
+  int64_t t;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (!timer_tickless || oneshot_ticks != 0 || !list_empty (&expired_list)
+      || wheel_ticks != ticks + 1)
+    return;
+
+  /* Find the first tick at which there is work. */
+  limit = ticks + 0xffff / tick_cycles;
+  if (limit > ROUND_UP (ticks + 1, WHEEL_SIZE))
+    limit = ROUND_UP (ticks + 1, WHEEL_SIZE);
+  if (thread_mlfqs && limit > ROUND_UP (ticks + 1, TIMER_FREQ))
+    limit = ROUND_UP (ticks + 1, TIMER_FREQ);
+  if (!list_empty (&sleep_list))
+    {
+      struct thread *sleeper = list_entry (list_front (&sleep_list),
+                                           struct thread, elem);
+      if (limit > sleeper->wakeup_tick)
+        limit = sleeper->wakeup_tick;
+    }
+  for (t = ticks + 1; t < limit; t++)
+    if (!list_empty (&wheel[0][t & WHEEL_MASK]))
+      {
+        limit = t;
+        break;
+      }
+  if (limit - ticks < 2)
+    return;
+
+  /* Fire at tick LIMIT, counting from where we are in the
+     current tick. */
+  oneshot_offset = pit_cycles_elapsed (0);
+  if (oneshot_offset >= tick_cycles)
+    return;
+  oneshot_idle = true;
+  oneshot_ticks = limit - ticks;
+  oneshot_cycles = oneshot_ticks * tick_cycles - oneshot_offset;
+  pit_start_oneshot (0, oneshot_cycles);
+}
+
+/* Called with interrupts off when a thread other than the idle
+   thread is scheduled.  If a one-shot interrupt from timer_idle()
+   is still pending, catches up on the whole ticks that have
+   passed and arms a one-shot for the rest of the current one, so
+   that its interrupt comes on time and restarts periodic
+   interrupts. */
+void
+timer_idle_exit (void)
+{
+  unsigned count, elapsed;
+  int64_t passed;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (!oneshot_idle)
+    return;
+
+  /* If the count ran out, the interrupt is already pending and
+     timer_interrupt() will do the work. */
+  count = pit_read_counter (0);
+  if (count == 0 || count > oneshot_cycles)
+    return;
+
+  elapsed = oneshot_cycles - count + oneshot_offset;
+  passed = elapsed / tick_cycles;
+  ticks += passed;
+  thread_idle_ticks (passed);
+
+  oneshot_idle = false;
+  oneshot_offset = elapsed % tick_cycles;
+  oneshot_ticks = 1;
+  oneshot_cycles = tick_cycles - oneshot_offset;
+  if (oneshot_cycles < 2)
+    oneshot_cycles = 2;
+  pit_start_oneshot (0, oneshot_cycles);
+}
+
 /* Sleeps for approximately TICKS timer ticks.  Interrupts must
-   be turned on. */
+   be turned on.  The thread blocks on sleep_list until
+   timer_interrupt() finds its wakeup tick has passed. */
 void
 timer_sleep (int64_t ticks) 
 {
   int64_t start = timer_ticks ();
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
 
   ASSERT (intr_get_level () == INTR_ON);
-  while (timer_elapsed (start) < ticks) 
-    thread_yield ();
+  if (ticks <= 0)
+    return;
+
+  old_level = intr_disable ();
+  cur->wakeup_tick = start + ticks;
+  list_insert_ordered (&sleep_list, &cur->elem, wakeup_less, NULL);
+  thread_block ();
+  intr_set_level (old_level);
 }
 
 /* Sleeps for approximately MS milliseconds.  Interrupts must be
@@ -159,21 +359,193 @@ timer_ndelay (int64_t ns)
   real_time_delay (ns, 1000 * 1000 * 1000);
 }
 
+/* Arms TO to call FUNC (AUX) once, TICKS timer ticks from now,
+   or at the next tick if TICKS is not positive.  TO must not
+   already be pending.  May be called from an interrupt
+   handler. */
+void
+timer_add (struct timeout *to, int64_t ticks, timeout_func *func, void *aux)
+{
+  enum intr_level old_level;
+
+  ASSERT (to != NULL);
+  ASSERT (func != NULL);
+
+  old_level = intr_disable ();
+  ASSERT (!to->pending);
+  to->expires = timer_ticks () + (ticks > 0 ? ticks : 1);
+  to->func = func;
+  to->aux = aux;
+  to->pending = true;
+  wheel_insert (to);
+  intr_set_level (old_level);
+}
+
+/* Disarms TO.  Returns true if TO was pending, false if it has
+   already run (or started running) or was never armed.  May be
+   called from an interrupt handler. */
+bool
+timer_cancel (struct timeout *to)
+{
+  enum intr_level old_level;
+  bool was_pending;
+
+  ASSERT (to != NULL);
+
+  old_level = intr_disable ();
+  was_pending = to->pending;
+  if (was_pending)
+    {
+      list_remove (&to->elem);
+      to->pending = false;
+    }
+  intr_set_level (old_level);
+  return was_pending;
+}
+
 /* Prints timer statistics. */
 void
 timer_print_stats (void) 
 {
   printf ("Timer: %"PRId64" ticks\n", timer_ticks ());
+  if (timer_tickless)
+    printf ("Timer: %lld interrupts while tickless\n", timer_interrupts);
 }
 
-/* Timer interrupt handler. */
+/* Timer interrupt handler.  Wakes every sleeper whose time has
+   come; since sleep_list is sorted, that costs O(1) per tick plus
+   O(1) per woken thread. */
 static void
 timer_interrupt (struct intr_frame *args UNUSED)
 {
-  ticks++;
+  timer_interrupts++;
+  if (oneshot_ticks != 0)
+    {
+      /* End of a tickless interval, in which the idle thread ran
+         for all but the tick that thread_tick() charges below, or
+         of the tick timer_idle_exit() finished. */
+      ticks += oneshot_ticks;
+      if (oneshot_idle)
+        thread_idle_ticks (oneshot_ticks - 1);
+      oneshot_idle = false;
+      oneshot_ticks = 0;
+      pit_configure_channel (0, 2, TIMER_FREQ);
+    }
+  else
+    ticks++;
+  while (!list_empty (&sleep_list))
+    {
+      struct thread *t = list_entry (list_front (&sleep_list),
+                                     struct thread, elem);
+      if (t->wakeup_tick > ticks)
+        break;
+      list_pop_front (&sleep_list);
+      thread_unblock (t);
+    }
+  while (wheel_ticks <= ticks)
+    wheel_advance ();
+  if (!list_empty (&expired_list))
+    sema_up (&softirq_sema);
   thread_tick ();
 }
 
+/* Puts TO in the wheel slot for its expiry tick.  Interrupts
+   must be off. */
+static void
+wheel_insert (struct timeout *to)
+{
+  int64_t expires = to->expires;
+  int64_t delta = expires - wheel_ticks;
+  int level;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (delta < 0)
+    {
+      expires = wheel_ticks;
+      delta = 0;
+    }
+  else if (delta >= WHEEL_SPAN)
+    {
+      expires = wheel_ticks + WHEEL_SPAN - 1;
+      delta = WHEEL_SPAN - 1;
+    }
+
+  for (level = 0; level < WHEEL_LEVELS - 1; level++)
+    if (delta < 1LL << (WHEEL_BITS * (level + 1)))
+      break;
+  list_push_back (&wheel[level][(expires >> (WHEEL_BITS * level))
+                                & WHEEL_MASK],
+                  &to->elem);
+}
+
+/* Runs the wheel for tick wheel_ticks: cascades higher levels
+   if the level 0 index wrapped, then moves everything due now
+   to expired_list. */
+static void
+wheel_advance (void)
+{
+  int slot = wheel_ticks & WHEEL_MASK;
+  int level;
+
+  if (slot == 0)
+    for (level = 1; level < WHEEL_LEVELS; level++)
+      {
+        int idx = (wheel_ticks >> (WHEEL_BITS * level)) & WHEEL_MASK;
+        struct list *l = &wheel[level][idx];
+
+        while (!list_empty (l))
+          wheel_insert (list_entry (list_pop_front (l),
+                                    struct timeout, elem));
+        if (idx != 0)
+          break;
+      }
+
+  while (!list_empty (&wheel[0][slot]))
+    list_push_back (&expired_list, list_pop_front (&wheel[0][slot]));
+  wheel_ticks++;
+}
+
+/* Timer softirq thread.  Runs the functions of expired timeouts
+   outside interrupt context. */
+static void
+timer_softirq (void *aux UNUSED)
+{
+  for (;;)
+    {
+      sema_down (&softirq_sema);
+      for (;;)
+        {
+          enum intr_level old_level = intr_disable ();
+          struct timeout *to;
+
+          if (list_empty (&expired_list))
+            {
+              intr_set_level (old_level);
+              break;
+            }
+          to = list_entry (list_pop_front (&expired_list),
+                           struct timeout, elem);
+          to->pending = false;
+          intr_set_level (old_level);
+
+          to->func (to->aux);
+        }
+    }
+}
+
+/* Orders threads on sleep_list by wakeup tick.  Threads with
+   equal ticks stay in the order they went to sleep. */
+static bool
+wakeup_less (const struct list_elem *a_, const struct list_elem *b_,
+             void *aux UNUSED)
+{
+  const struct thread *a = list_entry (a_, struct thread, elem);
+  const struct thread *b = list_entry (b_, struct thread, elem);
+
+  return a->wakeup_tick < b->wakeup_tick;
+}
+
 /* Returns true if LOOPS iterations waits for more than one timer
    tick, otherwise false. */
 static bool
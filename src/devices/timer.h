@@ -1,17 +1,34 @@
 #ifndef DEVICES_TIMER_H
 #define DEVICES_TIMER_H
 
+#include <list.h>
 #include <round.h>
+#include <stdbool.h>
 #include <stdint.h>
 
-/* Number of timer interrupts per second. */
-#define TIMER_FREQ 100
+/* Number of timer interrupts per second.  Defaults to
+   TIMER_FREQ_DEFAULT; controlled by kernel command-line option
+   "-hz=FREQ", between TIMER_FREQ_MIN and TIMER_FREQ_MAX. */
+#define TIMER_FREQ_DEFAULT 100
+#define TIMER_FREQ_MIN 19               /* 8254 counter limit. */
+#define TIMER_FREQ_MAX 1000
+extern int timer_freq;
+#define TIMER_FREQ timer_freq
+
+/* Stop the periodic interrupt while idle?
+   Controlled by kernel command-line option "-tickless". */
+extern bool timer_tickless;
 
 void timer_init (void);
+void timer_init_softirq (void);
 void timer_calibrate (void);
 
 int64_t timer_ticks (void);
 int64_t timer_elapsed (int64_t);
+int64_t timer_usecs (void);
+
+void timer_idle (void);
+void timer_idle_exit (void);
 
 /* Sleep and yield the CPU to other threads. */
 void timer_sleep (int64_t ticks);
@@ -24,6 +41,21 @@ void timer_mdelay (int64_t milliseconds);
 void timer_udelay (int64_t microseconds);
 void timer_ndelay (int64_t nanoseconds);
 
+/* One-shot timeouts.  A struct timeout belongs to its caller,
+   who must keep it alive until it has run or been cancelled. */
+typedef void timeout_func (void *aux);
+struct timeout
+  {
+    struct list_elem elem;      /* Wheel slot or expired list. */
+    int64_t expires;            /* Tick at which to run. */
+    timeout_func *func;         /* Run by the timer softirq thread. */
+    void *aux;                  /* Passed to FUNC. */
+    bool pending;               /* Armed, not yet run or cancelled. */
+  };
+
+void timer_add (struct timeout *, int64_t ticks, timeout_func *, void *aux);
+bool timer_cancel (struct timeout *);
+
 void timer_print_stats (void);
 
 #endif /* devices/timer.h */
@@ -3,6 +3,7 @@
 #include <string.h>
 #include <syscall.h>
 
+static pid_t run (char *command);
 static void read_line (char line[], size_t);
 static bool backspace (char **pos, char line[]);
 
@@ -32,7 +33,7 @@ main (void)
         }
       else
         {
-          pid_t pid = exec (command);
+          pid_t pid = run (command);
           if (pid != PID_ERROR)
             printf ("\"%s\": exit code %d\n", command, wait (pid));
           else
@@ -44,6 +45,36 @@ main (void)
   return EXIT_SUCCESS;
 }
 
+/* Starts COMMAND, which may end in "< FILE" or "> FILE" to take
+   standard input from or send standard output to an existing
+   FILE, and returns its pid. */
+static pid_t
+run (char *command)
+{
+  struct spawn_action action;
+  char *redirect = strpbrk (command, "<>");
+  char *file_name;
+  pid_t pid;
+
+  if (redirect == NULL)
+    return exec (command);
+
+  action.type = SPAWN_DUP;
+  action.newfd = *redirect == '<' ? STDIN_FILENO : STDOUT_FILENO;
+  *redirect = '\0';
+  for (file_name = redirect + 1; *file_name == ' '; file_name++)
+    continue;
+  action.fd = open (file_name);
+  if (action.fd < 0)
+    {
+      printf ("\"%s\": open failed\n", file_name);
+      return PID_ERROR;
+    }
+  pid = spawn (command, &action, 1);
+  close (action.fd);
+  return pid;
+}
+
 /* Reads a line of input from the user into LINE, which has room
    for SIZE bytes.  Handles backspace and Ctrl+U in the ways
    expected by Unix users.  On return, LINE will always be
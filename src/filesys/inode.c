@@ -6,6 +6,7 @@
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
 #include "threads/malloc.h"
+#include "threads/synch.h"
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
@@ -37,6 +38,8 @@ struct inode
     bool removed;                       /* True if deleted, false otherwise. */
     int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
     struct inode_disk data;             /* Inode content. */
+    void *exec_image;                   /* Loader's parsed header, or null. */
+    struct list_elem exec_elem;         /* Element in exec_images. */
   };
 
 /* Returns the block device sector that contains byte offset POS
@@ -57,11 +60,26 @@ byte_to_sector (const struct inode *inode, off_t pos)
    returns the same `struct inode'. */
 static struct list open_inodes;
 
+/* Inodes with an attached executable image, most recently used
+   first.  Each holds an extra reference to its inode, so that an
+   executable run over and over keeps its image between runs; at
+   most EXEC_IMAGE_MAX are kept.  EXEC_LOCK protects the list,
+   the count and every inode's image, so that the loader can use
+   an image without holding the file system lock. */
+#define EXEC_IMAGE_MAX 16
+static struct list exec_images;
+static size_t exec_image_cnt;
+static struct lock exec_lock;
+
+static void drop_exec_image (struct inode *);
+
 /* Initializes the inode module. */
 void
 inode_init (void) 
 {
   list_init (&open_inodes);
+  list_init (&exec_images);
+  lock_init (&exec_lock);
 }
 
 /* Initializes an inode with LENGTH bytes of data and
@@ -137,6 +155,7 @@ inode_open (block_sector_t sector)
   inode->open_cnt = 1;
   inode->deny_write_cnt = 0;
   inode->removed = false;
+  inode->exec_image = NULL;
   block_read (fs_device, inode->sector, &inode->data);
   return inode;
 }
@@ -192,6 +211,78 @@ inode_remove (struct inode *inode)
 {
   ASSERT (inode != NULL);
   inode->removed = true;
+  lock_acquire (&exec_lock);
+  drop_exec_image (inode);
+  lock_release (&exec_lock);
+}
+
+/* Acquires the lock on executable images.  An image obtained
+   from inode_exec_image() may be used only until the matching
+   inode_exec_unlock(). */
+void
+inode_exec_lock (void)
+{
+  lock_acquire (&exec_lock);
+}
+
+/* Releases the lock on executable images. */
+void
+inode_exec_unlock (void)
+{
+  lock_release (&exec_lock);
+}
+
+/* Returns the executable image attached to INODE by
+   inode_set_exec_image(), or a null pointer if there is none.
+   Caller must hold inode_exec_lock(). */
+void *
+inode_exec_image (struct inode *inode)
+{
+  ASSERT (lock_held_by_current_thread (&exec_lock));
+  if (inode->exec_image != NULL)
+    {
+      list_remove (&inode->exec_elem);
+      list_push_front (&exec_images, &inode->exec_elem);
+    }
+  return inode->exec_image;
+}
+
+/* Attaches IMAGE, a block obtained from malloc(), to INODE and
+   returns true.  The inode owns IMAGE from then on and frees it
+   once the file's contents change, the file is removed, or the
+   image is pushed out by newer ones.  Returns false, leaving
+   IMAGE to the caller, if INODE has been removed.  Caller must
+   hold inode_exec_lock() and the file system lock. */
+bool
+inode_set_exec_image (struct inode *inode, void *image)
+{
+  ASSERT (image != NULL);
+  ASSERT (lock_held_by_current_thread (&exec_lock));
+
+  drop_exec_image (inode);
+  if (inode->removed)
+    return false;
+  inode->exec_image = image;
+  list_push_front (&exec_images, &inode->exec_elem);
+  inode_reopen (inode);
+  if (++exec_image_cnt > EXEC_IMAGE_MAX)
+    drop_exec_image (list_entry (list_back (&exec_images),
+                                 struct inode, exec_elem));
+  return true;
+}
+
+/* Frees INODE's executable image, if any, and the reference
+   that came with it.  Caller must hold exec_lock. */
+static void
+drop_exec_image (struct inode *inode)
+{
+  if (inode->exec_image == NULL)
+    return;
+  list_remove (&inode->exec_elem);
+  exec_image_cnt--;
+  free (inode->exec_image);
+  inode->exec_image = NULL;
+  inode_close (inode);
 }
 
 /* Reads SIZE bytes from INODE into BUFFER, starting at position OFFSET.
@@ -264,6 +355,9 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 
   if (inode->deny_write_cnt)
     return 0;
+  lock_acquire (&exec_lock);
+  drop_exec_image (inode);
+  lock_release (&exec_lock);
 
   while (size > 0) 
     {
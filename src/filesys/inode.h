@@ -19,5 +19,9 @@ off_t inode_write_at (struct inode *, const void *, off_t size, off_t offset);
 void inode_deny_write (struct inode *);
 void inode_allow_write (struct inode *);
 off_t inode_length (const struct inode *);
+void inode_exec_lock (void);
+void inode_exec_unlock (void);
+void *inode_exec_image (struct inode *);
+bool inode_set_exec_image (struct inode *, void *image);
 
 #endif /* filesys/inode.h */
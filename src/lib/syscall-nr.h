@@ -28,7 +28,51 @@ enum
     SYS_MKDIR,                  /* Create a directory. */
     SYS_READDIR,                /* Reads a directory entry. */
     SYS_ISDIR,                  /* Tests if a fd represents a directory. */
-    SYS_INUMBER                 /* Returns the inode number for a fd. */
+    SYS_INUMBER,                /* Returns the inode number for a fd. */
+
+    /* Local extensions. */
+    SYS_VMSTAT,                 /* Reads a paging statistic. */
+    SYS_MEMLIMIT,               /* Caps a process's resident frames. */
+    SYS_SPAWN,                  /* Starts a process with chosen files. */
+    SYS_PIPE,                   /* Opens a pipe. */
+    SYS_SHM_OPEN,               /* Opens a shared memory segment. */
+    SYS_SHM_MAP,                /* Maps a shared memory segment. */
+    SYS_FUTEX_WAIT,             /* Sleeps while a word holds a value. */
+    SYS_FUTEX_WAKE,             /* Wakes threads sleeping on a word. */
+    SYS_THREAD_SPAWN,           /* Starts a thread in this process. */
+    SYS_THREAD_JOIN,            /* Waits for a thread to end. */
+    SYS_THREAD_EXIT             /* Ends the calling thread. */
+  };
+
+/* Paging statistics reported by SYS_VMSTAT. */
+enum vmstat_field
+  {
+    VMSTAT_MINOR_FAULTS,        /* Faults served without I/O. */
+    VMSTAT_MAJOR_FAULTS,        /* Faults read from file or swap. */
+    VMSTAT_EVICTIONS,           /* Frames lost to eviction. */
+    VMSTAT_SWAP_INS,            /* Pages read back from swap. */
+    VMSTAT_RESIDENT,            /* Frames currently held. */
+    VMSTAT_WORKING_SET          /* Pages touched in the last sample. */
   };
 
+/* One step in setting up the files of a process started by
+   SYS_SPAWN.  The child starts with no open files; the actions
+   are applied in order before it runs. */
+struct spawn_action
+  {
+    int type;                   /* SPAWN_DUP or SPAWN_CLOSE. */
+    int fd;                     /* Parent's file to dup, or child's
+                                   file to close. */
+    int newfd;                  /* Child's descriptor for SPAWN_DUP. */
+  };
+
+enum spawn_action_type
+  {
+    SPAWN_DUP,                  /* Child's NEWFD opens parent's FD. */
+    SPAWN_CLOSE                 /* Child's FD is closed. */
+  };
+
+/* Most actions one SYS_SPAWN accepts. */
+#define SPAWN_ACTIONS_MAX 16
+
 #endif /* lib/syscall-nr.h */
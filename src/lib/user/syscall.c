@@ -182,3 +182,79 @@ inumber (int fd)
 {
   return syscall1 (SYS_INUMBER, fd);
 }
+
+int
+vmstat (int field)
+{
+  return syscall1 (SYS_VMSTAT, field);
+}
+
+int
+memlimit (int pages)
+{
+  return syscall1 (SYS_MEMLIMIT, pages);
+}
+
+pid_t
+spawn (const char *cmd_line, const struct spawn_action *actions,
+       int action_cnt)
+{
+  return (pid_t) syscall3 (SYS_SPAWN, cmd_line, actions, action_cnt);
+}
+
+bool
+pipe (int fds[2])
+{
+  return syscall1 (SYS_PIPE, fds);
+}
+
+int
+shm_open (const char *name, unsigned size)
+{
+  return syscall2 (SYS_SHM_OPEN, name, size);
+}
+
+void *
+shm_map (int shmid, void *addr)
+{
+  return (void *) syscall2 (SYS_SHM_MAP, shmid, addr);
+}
+
+int
+futex_wait (int *addr, int expected)
+{
+  return syscall2 (SYS_FUTEX_WAIT, addr, expected);
+}
+
+int
+futex_wake (int *addr, int cnt)
+{
+  return syscall2 (SYS_FUTEX_WAKE, addr, cnt);
+}
+
+/* Where the kernel starts a thread from thread_spawn(). */
+static void NO_RETURN
+thread_start (void (*fn) (void *), void *aux)
+{
+  fn (aux);
+  thread_exit ();
+}
+
+tid_t
+thread_spawn (void (*fn) (void *), void *aux)
+{
+  return syscall3 (SYS_THREAD_SPAWN, thread_start, fn, aux);
+}
+
+int
+thread_join (tid_t tid)
+{
+  return syscall1 (SYS_THREAD_JOIN, tid);
+}
+
+void
+thread_exit (void)
+{
+  syscall0 (SYS_THREAD_EXIT);
+  NOT_REACHED ();
+}
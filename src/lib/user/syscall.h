@@ -3,11 +3,16 @@
 
 #include <stdbool.h>
 #include <debug.h>
+#include <syscall-nr.h>
 
 /* Process identifier. */
 typedef int pid_t;
 #define PID_ERROR ((pid_t) -1)
 
+/* Thread identifier. */
+typedef int tid_t;
+#define TID_ERROR ((tid_t) -1)
+
 /* Map region identifier. */
 typedef int mapid_t;
 #define MAP_FAILED ((mapid_t) -1)
@@ -45,4 +50,18 @@ bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir (int fd);
 int inumber (int fd);
 
+/* Local extensions. */
+int vmstat (int field);
+int memlimit (int pages);
+pid_t spawn (const char *cmd_line, const struct spawn_action *actions,
+             int action_cnt);
+bool pipe (int fds[2]);
+int shm_open (const char *name, unsigned size);
+void *shm_map (int shmid, void *addr);
+int futex_wait (int *addr, int expected);
+int futex_wake (int *addr, int cnt);
+tid_t thread_spawn (void (*fn) (void *), void *aux);
+int thread_join (tid_t);
+void thread_exit (void) NO_RETURN;
+
 #endif /* lib/user/syscall.h */
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(stride-ratio-2) begin
+(stride-ratio-2) Starting 2 threads...
+(stride-ratio-2) Sleeping 15 seconds to let threads run, please wait...
+(stride-ratio-2) Thread 0 with 100 tickets received its share.
+(stride-ratio-2) Thread 1 with 300 tickets received its share.
+(stride-ratio-2) end
+EOF
+pass;
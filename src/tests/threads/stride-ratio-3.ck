@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(stride-ratio-3) begin
+(stride-ratio-3) Starting 3 threads...
+(stride-ratio-3) Sleeping 15 seconds to let threads run, please wait...
+(stride-ratio-3) Thread 0 with 100 tickets received its share.
+(stride-ratio-3) Thread 1 with 200 tickets received its share.
+(stride-ratio-3) Thread 2 with 300 tickets received its share.
+(stride-ratio-3) end
+EOF
+pass;
@@ -0,0 +1,112 @@
+/* Checks that the stride scheduler divides the CPU in proportion
+   to tickets.
+
+   The stride-ratio-2 test runs 2 threads with 100 and 300
+   tickets, and the stride-ratio-3 test runs 3 threads with 100,
+   200 and 300 tickets.  The threads all spin for the same 10
+   seconds, counting the ticks on which they see the timer
+   advance, and each must receive its share of the total to
+   within 20%. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+static void test_stride_ratio (int thread_cnt, const int tickets[]);
+
+void
+test_stride_ratio_2 (void)
+{
+  static const int tickets[] = {100, 300};
+  test_stride_ratio (2, tickets);
+}
+
+void
+test_stride_ratio_3 (void)
+{
+  static const int tickets[] = {100, 200, 300};
+  test_stride_ratio (3, tickets);
+}
+
+#define MAX_THREAD_CNT 3
+
+struct thread_info
+  {
+    int64_t start_time;
+    int tick_count;
+    int tickets;
+  };
+
+static void load_thread (void *aux);
+
+static void
+test_stride_ratio (int thread_cnt, const int tickets[])
+{
+  struct thread_info info[MAX_THREAD_CNT];
+  int64_t start_time;
+  int total_tickets, total_ticks;
+  int i;
+
+  ASSERT (thread_stride);
+  ASSERT (thread_cnt <= MAX_THREAD_CNT);
+
+  start_time = timer_ticks ();
+  msg ("Starting %d threads...", thread_cnt);
+  for (i = 0; i < thread_cnt; i++)
+    {
+      struct thread_info *ti = &info[i];
+      char name[16];
+
+      ti->start_time = start_time;
+      ti->tick_count = 0;
+      ti->tickets = tickets[i];
+
+      snprintf (name, sizeof name, "load %d", i);
+      thread_create (name, PRI_DEFAULT, load_thread, ti);
+    }
+
+  msg ("Sleeping 15 seconds to let threads run, please wait...");
+  timer_sleep (15 * TIMER_FREQ);
+
+  total_tickets = total_ticks = 0;
+  for (i = 0; i < thread_cnt; i++)
+    {
+      total_tickets += info[i].tickets;
+      total_ticks += info[i].tick_count;
+    }
+  for (i = 0; i < thread_cnt; i++)
+    {
+      int expected = total_ticks * info[i].tickets / total_tickets;
+      int diff = info[i].tick_count - expected;
+
+      if (diff < 0)
+        diff = -diff;
+      if (diff > expected / 5)
+        fail ("thread %d with %d tickets received %d of %d ticks, "
+              "expected about %d",
+              i, info[i].tickets, info[i].tick_count, total_ticks, expected);
+      msg ("Thread %d with %d tickets received its share.",
+           i, info[i].tickets);
+    }
+}
+
+static void
+load_thread (void *ti_)
+{
+  struct thread_info *ti = ti_;
+  int64_t sleep_time = 2 * TIMER_FREQ;
+  int64_t spin_time = sleep_time + 10 * TIMER_FREQ;
+  int64_t last_time = 0;
+
+  thread_set_tickets (ti->tickets);
+  timer_sleep (sleep_time - timer_elapsed (ti->start_time));
+  while (timer_elapsed (ti->start_time) < spin_time)
+    {
+      int64_t cur_time = timer_ticks ();
+      if (cur_time != last_time)
+        ti->tick_count++;
+      last_time = cur_time;
+    }
+}
@@ -38,6 +38,11 @@ static const struct test tests[] =
     {"mlfqs-nice-2", test_mlfqs_nice_2},
     {"mlfqs-nice-10", test_mlfqs_nice_10},
     {"mlfqs-block", test_mlfqs_block},
+    {"timer-wheel", test_timer_wheel},
+    {"stride-ratio-2", test_stride_ratio_2},
+    {"stride-ratio-3", test_stride_ratio_3},
+    {"thread-churn", test_thread_churn},
+    {"timer-tickless", test_timer_tickless},
   };
 
 static const char *test_name;
@@ -32,6 +32,11 @@ extern test_func test_mlfqs_fair_20;
 extern test_func test_mlfqs_nice_2;
 extern test_func test_mlfqs_nice_10;
 extern test_func test_mlfqs_block;
+extern test_func test_timer_wheel;
+extern test_func test_stride_ratio_2;
+extern test_func test_stride_ratio_3;
+extern test_func test_thread_churn;
+extern test_func test_timer_tickless;
 
 void msg (const char *, ...);
 void fail (const char *, ...);
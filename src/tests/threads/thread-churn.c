@@ -0,0 +1,53 @@
+/* Measures how fast threads can be created and reaped.  Each of
+   THREAD_CNT threads outranks the creator, so it runs and exits
+   before thread_create() returns, and its page is released
+   before the next creation.  The test runs once with the thread
+   page cache disabled and once with it enabled, and reports the
+   time per thread for each. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define THREAD_CNT 2000
+
+static void churn (const char *label);
+
+static void
+exit_thread (void *aux UNUSED)
+{
+}
+
+void
+test_thread_churn (void)
+{
+  unsigned cache_max = thread_page_cache_max;
+
+  ASSERT (!thread_mlfqs && !thread_stride);
+
+  thread_page_cache_max = 0;
+  churn ("uncached");
+  thread_page_cache_max = cache_max;
+  churn ("cached");
+  pass ();
+}
+
+/* Creates and reaps THREAD_CNT threads and reports how long that
+   took, labelled LABEL. */
+static void
+churn (const char *label)
+{
+  int64_t start;
+  int i;
+
+  msg ("Creating %d %s threads.", THREAD_CNT, label);
+  start = timer_usecs ();
+  for (i = 0; i < THREAD_CNT; i++)
+    if (thread_create ("churn", PRI_DEFAULT + 1, exit_thread, NULL)
+        == TID_ERROR)
+      fail ("thread_create failed after %d threads", i);
+  printf ("(thread-churn) %s: %"PRId64" us per thread\n",
+          label, (timer_usecs () - start) / THREAD_CNT);
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = grep (!/^\(thread-churn\) \w+: \d+ us per thread$/, @output);
+compare_output ("run", \@output, [<<'EOF']);
+(thread-churn) begin
+(thread-churn) Creating 2000 uncached threads.
+(thread-churn) Creating 2000 cached threads.
+(thread-churn) PASS
+(thread-churn) end
+EOF
+pass;
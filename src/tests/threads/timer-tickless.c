@@ -0,0 +1,63 @@
+/* Checks that timer ticks keep pace with the real-time clock in
+   tickless mode, while a thread writing to the serial port keeps
+   waking up in the middle of tickless intervals.  Must be run
+   with -tickless. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/thread.h"
+#include "devices/rtc.h"
+#include "devices/timer.h"
+
+/* Real-time seconds to measure. */
+#define SECONDS 5
+
+/* Most lines the writer prints. */
+#define LINE_CNT 2000
+
+static volatile bool done;
+
+static void
+writer (void *aux UNUSED)
+{
+  int i;
+
+  for (i = 0; i < LINE_CNT && !done; i++)
+    printf ("(timer-tickless) ........................................\n");
+}
+
+/* Sleeps until the real-time clock's next second starts and
+   returns the tick count then, late by at most a tick. */
+static int64_t
+next_second (void)
+{
+  time_t start = rtc_get_time ();
+
+  while (rtc_get_time () == start)
+    timer_sleep (1);
+  return timer_ticks ();
+}
+
+void
+test_timer_tickless (void)
+{
+  int64_t start, ticks, slack;
+  int i;
+
+  ASSERT (timer_tickless);
+
+  msg ("Measuring %d seconds of real time.", SECONDS);
+  start = next_second ();
+  thread_create ("writer", PRI_DEFAULT, writer, NULL);
+  for (i = 0; i < SECONDS; i++)
+    next_second ();
+  ticks = timer_ticks () - start;
+  done = true;
+
+  /* A tick at each end, and 2%. */
+  slack = 2 + SECONDS * TIMER_FREQ / 50;
+  if (ticks < SECONDS * TIMER_FREQ - slack
+      || ticks > SECONDS * TIMER_FREQ + slack)
+    fail ("%lld ticks in %d seconds at %d Hz", ticks, SECONDS, TIMER_FREQ);
+  pass ();
+}
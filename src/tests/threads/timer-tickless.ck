@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = grep (!/^\(timer-tickless\) \.+$/, @output);
+compare_output ("run", \@output, [<<'EOF']);
+(timer-tickless) begin
+(timer-tickless) Measuring 5 seconds of real time.
+(timer-tickless) PASS
+(timer-tickless) end
+EOF
+pass;
@@ -0,0 +1,90 @@
+/* Arms 10,000 timeouts with timer_add(), spread over every level
+   of the timer wheel that they can reach in a few seconds,
+   cancels every third one, and checks that exactly the rest run,
+   none of them early, and that cancelling a timeout that already
+   ran fails.  Also reports how long arming took. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define TIMER_CNT 10000
+#define MAX_DELAY 700
+
+struct wheel_test
+  {
+    struct timeout timeout;
+    int64_t deadline;           /* Earliest tick it may run. */
+    int runs;                   /* Times it has run. */
+  };
+
+static int fired;
+static int early;
+
+static void
+wheel_test_func (void *wt_)
+{
+  struct wheel_test *wt = wt_;
+  enum intr_level old_level = intr_disable ();
+
+  if (timer_ticks () < wt->deadline)
+    early++;
+  wt->runs++;
+  fired++;
+  intr_set_level (old_level);
+}
+
+void
+test_timer_wheel (void)
+{
+  struct wheel_test *tests;
+  int64_t start;
+  int i, cancelled, bad;
+
+  tests = malloc (sizeof *tests * TIMER_CNT);
+  if (tests == NULL)
+    PANIC ("couldn't allocate timeouts");
+
+  msg ("Arming %d timeouts of 1 to %d ticks.", TIMER_CNT, MAX_DELAY);
+  start = timer_ticks ();
+  for (i = 0; i < TIMER_CNT; i++)
+    {
+      /* Half go on level 0, half on the levels above it. */
+      int delay = i % 2 ? 1 + i % 63 : 64 + i % (MAX_DELAY - 63);
+
+      tests[i].timeout.pending = false;
+      tests[i].deadline = timer_ticks () + delay;
+      tests[i].runs = 0;
+      timer_add (&tests[i].timeout, delay, wheel_test_func, &tests[i]);
+    }
+  printf ("(timer-wheel) armed in %"PRId64" ticks\n", timer_elapsed (start));
+
+  msg ("Cancelling every third timeout.");
+  cancelled = 0;
+  for (i = 0; i < TIMER_CNT; i += 3)
+    if (timer_cancel (&tests[i].timeout))
+      cancelled++;
+
+  timer_sleep (MAX_DELAY + 10);
+
+  bad = 0;
+  for (i = 0; i < TIMER_CNT; i++)
+    if (tests[i].runs > 1 || (i % 3 != 0 && tests[i].runs != 1))
+      bad++;
+  if (bad != 0)
+    fail ("%d timeouts ran the wrong number of times", bad);
+  if (fired + cancelled != TIMER_CNT)
+    fail ("%d ran and %d were cancelled, of %d", fired, cancelled, TIMER_CNT);
+  if (early != 0)
+    fail ("%d timeouts ran early", early);
+  for (i = 1; i < TIMER_CNT; i += 3)
+    if (timer_cancel (&tests[i].timeout))
+      fail ("cancelled timeout %d after it ran", i);
+
+  free (tests);
+  pass ();
+}
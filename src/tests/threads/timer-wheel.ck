@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = grep (!/^\(timer-wheel\) armed in \d+ ticks$/, @output);
+compare_output ("run", \@output, [<<'EOF']);
+(timer-wheel) begin
+(timer-wheel) Arming 10000 timeouts of 1 to 700 ticks.
+(timer-wheel) Cancelling every third timeout.
+(timer-wheel) PASS
+(timer-wheel) end
+EOF
+pass;
@@ -0,0 +1,21 @@
+/* Child process run by exec-long-args test.
+   Checks that every argument is "arg" and exits with the
+   argument count. */
+
+#include <string.h>
+#include "tests/lib.h"
+
+int
+main (int argc, char *argv[]) 
+{
+  int i;
+
+  test_name = "child-argc";
+
+  for (i = 1; i < argc; i++)
+    if (strcmp (argv[i], "arg"))
+      fail ("argv[%d] = '%s'", i, argv[i]);
+  if (argv[argc] != NULL)
+    fail ("argv[%d] is not null", argc);
+  return argc;
+}
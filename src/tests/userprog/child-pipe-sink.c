@@ -0,0 +1,34 @@
+/* Child process run by pipe-stream test.
+   Reads its standard input to end of file, checking every byte,
+   and reports how many bytes arrived. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/userprog/pipe-stream.h"
+
+static unsigned char buf[CHUNK_SIZE]
+  __attribute__ ((aligned (CHUNK_SIZE)));
+
+int
+main (void) 
+{
+  size_t total = 0;
+  int n;
+
+  test_name = "child-pipe-sink";
+
+  while ((n = read (STDIN_FILENO, buf, sizeof buf)) > 0)
+    {
+      int i;
+
+      for (i = 0; i < n; i++)
+        if (buf[i] != STREAM_BYTE (total + i))
+          fail ("byte %zu of stream is wrong", total + i);
+      total += n;
+    }
+  if (n < 0)
+    fail ("read failed");
+  msg ("read %zu bytes", total);
+  return 0;
+}
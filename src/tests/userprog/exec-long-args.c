@@ -0,0 +1,26 @@
+/* Executes a child whose command line, and so its argument
+   vector, spans several pages of its stack. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ARG_CNT 2000
+
+static char cmdline[sizeof "child-argc" + ARG_CNT * 4];
+
+void
+test_main (void) 
+{
+  char *p;
+  int i;
+
+  strlcpy (cmdline, "child-argc", sizeof cmdline);
+  p = cmdline + strlen (cmdline);
+  for (i = 0; i < ARG_CNT; i++, p += 4)
+    memcpy (p, " arg", 4);
+  *p = '\0';
+
+  msg ("wait(exec()) = %d", wait (exec (cmdline)));
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(exec-long-args) begin
+child-argc: exit(2001)
+(exec-long-args) wait(exec()) = 2001
+(exec-long-args) end
+exec-long-args: exit(0)
+EOF
+pass;
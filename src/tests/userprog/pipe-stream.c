@@ -0,0 +1,43 @@
+/* Streams 100 MB through a pipe to a child process, which checks
+   every byte.  Doubles as a throughput benchmark: the kernel's
+   tick count at shutdown is the time it took. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include <syscall-nr.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/userprog/pipe-stream.h"
+
+static unsigned char buf[CHUNK_SIZE]
+  __attribute__ ((aligned (CHUNK_SIZE)));
+
+void
+test_main (void) 
+{
+  struct spawn_action action;
+  int fds[2];
+  pid_t pid;
+  size_t ofs;
+
+  CHECK (pipe (fds), "pipe");
+  action.type = SPAWN_DUP;
+  action.fd = fds[0];
+  action.newfd = STDIN_FILENO;
+  CHECK ((pid = spawn ("child-pipe-sink", &action, 1)) != PID_ERROR,
+         "spawn child-pipe-sink");
+  close (fds[0]);
+
+  for (ofs = 0; ofs < STREAM_SIZE; ofs += CHUNK_SIZE)
+    {
+      size_t i;
+
+      for (i = 0; i < CHUNK_SIZE; i++)
+        buf[i] = STREAM_BYTE (ofs + i);
+      if (write (fds[1], buf, CHUNK_SIZE) != CHUNK_SIZE)
+        fail ("write at offset %zu failed", ofs);
+    }
+  close (fds[1]);
+
+  CHECK (wait (pid) == 0, "wait for child-pipe-sink");
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pipe-stream) begin
+(pipe-stream) pipe
+(pipe-stream) spawn child-pipe-sink
+(child-pipe-sink) read 104857600 bytes
+child-pipe-sink: exit(0)
+(pipe-stream) wait for child-pipe-sink
+(pipe-stream) end
+pipe-stream: exit(0)
+EOF
+pass;
@@ -0,0 +1,13 @@
+#ifndef TESTS_USERPROG_PIPE_STREAM_H
+#define TESTS_USERPROG_PIPE_STREAM_H
+
+/* Bytes sent through the pipe, and in each write() or read().
+   Buffers are a page each and page-aligned, so that the kernel
+   may flip pages instead of copying. */
+#define STREAM_SIZE (100 * 1024 * 1024)
+#define CHUNK_SIZE 4096
+
+/* Byte at offset OFS of the stream. */
+#define STREAM_BYTE(OFS) ((unsigned char) ((OFS) % 251))
+
+#endif /* tests/userprog/pipe-stream.h */
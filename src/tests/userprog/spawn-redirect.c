@@ -0,0 +1,27 @@
+/* Spawns a child with its standard output redirected to a file,
+   then checks that the child's output landed there. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include <syscall-nr.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  static const char expected[] = "(child-simple) run\n";
+  struct spawn_action action;
+  int fd;
+
+  CHECK (create ("out", sizeof expected - 1), "create \"out\"");
+  CHECK ((fd = open ("out")) > 1, "open \"out\"");
+
+  action.type = SPAWN_DUP;
+  action.fd = fd;
+  action.newfd = STDOUT_FILENO;
+  CHECK (wait (spawn ("child-simple", &action, 1)) == 81, "wait(spawn())");
+  close (fd);
+
+  check_file ("out", expected, sizeof expected - 1);
+}
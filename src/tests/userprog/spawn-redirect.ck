@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(spawn-redirect) begin
+(spawn-redirect) create "out"
+(spawn-redirect) open "out"
+child-simple: exit(81)
+(spawn-redirect) wait(spawn())
+(spawn-redirect) verified contents of "out"
+(spawn-redirect) end
+spawn-redirect: exit(0)
+EOF
+pass;
@@ -0,0 +1,31 @@
+/* Calls exit() in one thread while another spins and the main
+   thread sleeps in futex_wait().  The whole process must end
+   with the status passed to exit(). */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static int never;
+
+static void
+spin (void *aux UNUSED)
+{
+  for (;;)
+    continue;
+}
+
+static void
+quit (void *aux UNUSED)
+{
+  exit (42);
+}
+
+void
+test_main (void)
+{
+  CHECK (thread_spawn (spin, NULL) != TID_ERROR, "thread_spawn spin");
+  CHECK (thread_spawn (quit, NULL) != TID_ERROR, "thread_spawn quit");
+  futex_wait (&never, 0);
+  fail ("main thread returned from futex_wait");
+}
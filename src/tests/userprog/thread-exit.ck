@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(thread-exit) begin
+(thread-exit) thread_spawn spin
+(thread-exit) thread_spawn quit
+thread-exit: exit(42)
+EOF
+pass;
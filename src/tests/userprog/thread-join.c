@@ -0,0 +1,69 @@
+/* Sums an array with several threads of one process, each with a
+   stack of its own, and joins them.  Then leaves a thread
+   spinning and returns from main(), which must end the process
+   all the same. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define THREAD_CNT 4
+#define ELEM_CNT 4096
+
+static int array[ELEM_CNT];
+static int sums[THREAD_CNT];
+static void *stacks[THREAD_CNT];
+static volatile bool go;
+
+static void
+sum (void *aux)
+{
+  int idx = (int) aux;
+  int i;
+
+  /* Keep every thread alive until all have started. */
+  stacks[idx] = &i;
+  while (!go)
+    continue;
+  for (i = idx; i < ELEM_CNT; i += THREAD_CNT)
+    sums[idx] += array[i];
+}
+
+static void
+spin (void *aux UNUSED)
+{
+  for (;;)
+    continue;
+}
+
+void
+test_main (void)
+{
+  tid_t tids[THREAD_CNT];
+  int total = 0;
+  int i, j;
+
+  for (i = 0; i < ELEM_CNT; i++)
+    array[i] = i;
+
+  for (i = 0; i < THREAD_CNT; i++)
+    CHECK ((tids[i] = thread_spawn (sum, (void *) i)) != TID_ERROR,
+           "thread_spawn %d", i);
+  go = true;
+  for (i = 0; i < THREAD_CNT; i++)
+    CHECK (thread_join (tids[i]) == 0, "thread_join %d", i);
+  CHECK (thread_join (tids[0]) == -1, "thread_join twice");
+
+  for (i = 0; i < THREAD_CNT; i++)
+    {
+      total += sums[i];
+      for (j = 0; j < i; j++)
+        if (stacks[i] == stacks[j])
+          fail ("threads %d and %d share a stack", j, i);
+    }
+  if (total != ELEM_CNT * (ELEM_CNT - 1) / 2)
+    fail ("sum is %d", total);
+  msg ("sum is %d", total);
+
+  CHECK (thread_spawn (spin, NULL) != TID_ERROR, "thread_spawn spin");
+}
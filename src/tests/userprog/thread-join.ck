@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(thread-join) begin
+(thread-join) thread_spawn 0
+(thread-join) thread_spawn 1
+(thread-join) thread_spawn 2
+(thread-join) thread_spawn 3
+(thread-join) thread_join 0
+(thread-join) thread_join 1
+(thread-join) thread_join 2
+(thread-join) thread_join 3
+(thread-join) thread_join twice
+(thread-join) sum is 8386560
+(thread-join) thread_spawn spin
+(thread-join) end
+thread-join: exit(0)
+EOF
+pass;
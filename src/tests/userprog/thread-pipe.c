@@ -0,0 +1,58 @@
+/* Calls exit() in one thread while the main thread and another
+   read a pipe whose only writer is the process itself, and a
+   third joins the reader.  None of them can return on its own,
+   so the process ends only if exit() wakes them. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static int fds[2];
+static tid_t reader_tid;
+static volatile bool reading, joining, main_reading;
+
+static void
+reader (void *aux UNUSED)
+{
+  char c;
+
+  reading = true;
+  read (fds[0], &c, 1);
+  fail ("reader returned from read");
+}
+
+static void
+joiner (void *aux UNUSED)
+{
+  joining = true;
+  thread_join (reader_tid);
+  fail ("joiner returned from thread_join");
+}
+
+static void
+quit (void *aux UNUSED)
+{
+  int i;
+
+  while (!reading || !joining || !main_reading)
+    continue;
+  /* Give the others time to block. */
+  for (i = 0; i < 1000000; i++)
+    asm volatile ("");
+  exit (43);
+}
+
+void
+test_main (void)
+{
+  char c;
+
+  CHECK (pipe (fds), "pipe");
+  CHECK ((reader_tid = thread_spawn (reader, NULL)) != TID_ERROR,
+         "thread_spawn reader");
+  CHECK (thread_spawn (joiner, NULL) != TID_ERROR, "thread_spawn joiner");
+  CHECK (thread_spawn (quit, NULL) != TID_ERROR, "thread_spawn quit");
+  main_reading = true;
+  read (fds[0], &c, 1);
+  fail ("main thread returned from read");
+}
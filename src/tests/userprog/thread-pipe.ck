@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(thread-pipe) begin
+(thread-pipe) pipe
+(thread-pipe) thread_spawn reader
+(thread-pipe) thread_spawn joiner
+(thread-pipe) thread_spawn quit
+thread-pipe: exit(43)
+EOF
+pass;
@@ -0,0 +1,36 @@
+/* Child process for futex-lock test.
+   Increments the shared counter under the shared mutex, slowly
+   enough that the children get preempted inside the critical
+   section. */
+
+#include <syscall.h>
+#include "tests/vm/futex-mutex.h"
+#include "tests/lib.h"
+
+const char *test_name = "child-futex";
+
+int
+main (void)
+{
+  struct futex_shared *s = (struct futex_shared *) 0x20000000;
+  int shmid;
+  int i;
+
+  shmid = shm_open (FUTEX_SHM_NAME, sizeof *s);
+  if (shmid < 0 || shm_map (shmid, s) != s)
+    fail ("cannot map segment");
+
+  for (i = 0; i < FUTEX_ROUNDS; i++)
+    {
+      volatile int spin;
+      int counter;
+
+      mutex_lock (&s->mutex);
+      counter = s->counter;
+      for (spin = 0; spin < 100; spin++)
+        continue;
+      s->counter = counter + 1;
+      mutex_unlock (&s->mutex);
+    }
+  return 0;
+}
@@ -0,0 +1,22 @@
+/* Child process of page-reap.
+   Dirties 2 MB of memory while capped at a quarter of that, so
+   that most of it ends up in swap. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+
+const char *test_name = "child-reap";
+
+#define PAGE_CNT 512
+static char buf[PAGE_CNT * 4096];
+
+int
+main (void)
+{
+  size_t i;
+
+  memlimit (PAGE_CNT / 4);
+  for (i = 0; i < PAGE_CNT; i++)
+    buf[i * 4096] = i;
+  return 0x42;
+}
@@ -0,0 +1,26 @@
+/* Child process for shm-reopen test.
+   Creates the segment, which no other process holds, and fills
+   it before exiting. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/shm.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  char *shm = (char *) 0x20000000;
+  int shmid;
+  size_t i;
+
+  shmid = shm_open (SHM_REOPEN_NAME, SHM_SIZE);
+  if (shmid < 0 || shm_map (shmid, shm) != shm)
+    fail ("cannot map segment");
+  for (i = 0; i < SHM_SIZE; i++)
+    if (shm[i] != 0)
+      fail ("byte %zu is %d", i, shm[i]);
+  memset (shm, 0x5a, SHM_SIZE);
+  msg ("segment filled");
+}
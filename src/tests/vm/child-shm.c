@@ -0,0 +1,27 @@
+/* Child process for shm-share test.
+   Maps the parent's segment at a different address, checks its
+   contents and writes a reply to the start of every page. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/shm.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  char *shm = (char *) 0x20000000;
+  int shmid;
+  size_t i;
+
+  shmid = shm_open (SHM_NAME, SHM_SIZE);
+  if (shmid < 0 || shm_map (shmid, shm) != shm)
+    fail ("cannot map segment");
+  for (i = 0; i < SHM_SIZE; i++)
+    if (shm[i] != (char) (i % 251))
+      fail ("byte %zu is %d", i, shm[i]);
+  for (i = 0; i < SHM_SIZE; i += 4096)
+    strlcpy (shm + i, SHM_REPLY, sizeof SHM_REPLY);
+  msg ("segment verified");
+}
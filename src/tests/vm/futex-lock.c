@@ -0,0 +1,37 @@
+/* Runs several children that each increment a counter in shared
+   memory many times under a futex-based mutex, and checks that
+   no increment was lost.  Also checks that futex_wait() returns
+   at once when the word does not hold the expected value. */
+
+#include <syscall.h>
+#include "tests/vm/futex-mutex.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  struct futex_shared *s = (struct futex_shared *) 0x10000000;
+  pid_t children[FUTEX_CHILDREN];
+  int word = 1;
+  int shmid;
+  int i;
+
+  CHECK (futex_wait (&word, 0) == -1, "futex_wait on changed word");
+  CHECK (futex_wake (&word, 1) == 0, "futex_wake with no waiters");
+
+  CHECK ((shmid = shm_open (FUTEX_SHM_NAME, sizeof *s)) >= 0,
+         "shm_open \"%s\"", FUTEX_SHM_NAME);
+  CHECK (shm_map (shmid, s) == s, "shm_map");
+
+  for (i = 0; i < FUTEX_CHILDREN; i++)
+    CHECK ((children[i] = exec ("child-futex")) != -1,
+           "exec \"child-futex\"");
+  for (i = 0; i < FUTEX_CHILDREN; i++)
+    CHECK (wait (children[i]) == 0, "wait for child %d", i);
+
+  if (s->counter != FUTEX_CHILDREN * FUTEX_ROUNDS)
+    fail ("counter is %d, expected %d",
+          s->counter, FUTEX_CHILDREN * FUTEX_ROUNDS);
+  msg ("counter is %d", s->counter);
+}
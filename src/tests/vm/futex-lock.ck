@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(futex-lock) begin
+(futex-lock) futex_wait on changed word
+(futex-lock) futex_wake with no waiters
+(futex-lock) shm_open "futex-lock"
+(futex-lock) shm_map
+(futex-lock) exec "child-futex"
+(futex-lock) exec "child-futex"
+(futex-lock) exec "child-futex"
+(futex-lock) exec "child-futex"
+(futex-lock) wait for child 0
+(futex-lock) wait for child 1
+(futex-lock) wait for child 2
+(futex-lock) wait for child 3
+(futex-lock) counter is 8000
+(futex-lock) end
+EOF
+pass;
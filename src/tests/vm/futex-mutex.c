@@ -0,0 +1,27 @@
+#include "tests/vm/futex-mutex.h"
+#include <syscall.h>
+
+void
+mutex_lock (int *mutex)
+{
+  int c = __sync_val_compare_and_swap (mutex, 0, 1);
+  if (c == 0)
+    return;
+  if (c != 2)
+    c = __sync_lock_test_and_set (mutex, 2);
+  while (c != 0)
+    {
+      futex_wait (mutex, 2);
+      c = __sync_lock_test_and_set (mutex, 2);
+    }
+}
+
+void
+mutex_unlock (int *mutex)
+{
+  if (__sync_fetch_and_sub (mutex, 1) != 1)
+    {
+      *mutex = 0;
+      futex_wake (mutex, 1);
+    }
+}
@@ -0,0 +1,21 @@
+#ifndef TESTS_VM_FUTEX_MUTEX_H
+#define TESTS_VM_FUTEX_MUTEX_H 1
+
+/* A mutex in user memory that enters the kernel only when
+   contended.  0 is unlocked, 1 locked, and 2 locked with
+   waiters. */
+void mutex_lock (int *mutex);
+void mutex_unlock (int *mutex);
+
+/* Layout of the segment shared by futex-lock and child-futex. */
+#define FUTEX_SHM_NAME "futex-lock"
+#define FUTEX_CHILDREN 4
+#define FUTEX_ROUNDS 2000
+
+struct futex_shared
+  {
+    int mutex;
+    int counter;
+  };
+
+#endif /* tests/vm/futex-mutex.h */
@@ -0,0 +1,38 @@
+/* Writes a file from, and reads it back into, a buffer bigger
+   than user memory.  Only the part of the buffer that the file
+   covers is ever touched, so this works only if the kernel does
+   not make the whole buffer resident at once. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (4 * 1024 * 1024)
+#define FILE_SIZE (100 * 1024)
+
+static char buf[SIZE];
+
+void
+test_main (void)
+{
+  int handle;
+  size_t i;
+
+  CHECK (create ("big", FILE_SIZE), "create \"big\"");
+  CHECK ((handle = open ("big")) > 1, "open \"big\"");
+
+  for (i = 0; i < FILE_SIZE; i++)
+    buf[i] = i % 251;
+  CHECK (write (handle, buf, SIZE) == FILE_SIZE, "write 4 MB buffer");
+
+  memset (buf, 0, FILE_SIZE);
+  seek (handle, 0);
+  CHECK (read (handle, buf, SIZE) == FILE_SIZE, "read 4 MB buffer");
+  for (i = 0; i < FILE_SIZE; i++)
+    if (buf[i] != (char) (i % 251))
+      fail ("byte %zu of \"big\" has value %02hhx (should be %02hhx)",
+            i, buf[i], (char) (i % 251));
+
+  close (handle);
+}
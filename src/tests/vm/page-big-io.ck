@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-big-io) begin
+(page-big-io) create "big"
+(page-big-io) open "big"
+(page-big-io) write 4 MB buffer
+(page-big-io) read 4 MB buffer
+(page-big-io) end
+EOF
+pass;
@@ -0,0 +1,36 @@
+/* Caps the process at a few resident frames, dirties many more
+   pages than that, and checks that the process replaced its own
+   frames and that every page survived the round trip through
+   swap. */
+
+#include <syscall.h>
+#include <syscall-nr.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define LIMIT 16
+#define PAGE_CNT 64
+
+static char buf[PAGE_CNT * 4096];
+
+void
+test_main (void)
+{
+  size_t i;
+
+  CHECK (memlimit (LIMIT) == 0, "memlimit (%d)", LIMIT);
+
+  for (i = 0; i < PAGE_CNT; i++)
+    buf[i * 4096] = i;
+
+  CHECK (vmstat (VMSTAT_RESIDENT) <= LIMIT, "resident frames within limit");
+  CHECK (vmstat (VMSTAT_EVICTIONS) >= PAGE_CNT - LIMIT,
+         "own frames evicted");
+
+  msg ("verify");
+  for (i = 0; i < PAGE_CNT; i++)
+    if (buf[i * 4096] != (char) i)
+      fail ("page %zu corrupted", i);
+
+  CHECK (memlimit (0) == LIMIT, "memlimit (0)");
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-limit) begin
+(page-limit) memlimit (16)
+(page-limit) resident frames within limit
+(page-limit) own frames evicted
+(page-limit) verify
+(page-limit) memlimit (0)
+(page-limit) end
+EOF
+pass;
@@ -0,0 +1,25 @@
+/* Runs a child with a large, partly swapped-out address space
+   several times over.  Each child's frames and swap slots must
+   all come back when it exits, or later children run out. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CHILD_CNT 8
+
+void
+test_main (void)
+{
+  int i;
+
+  for (i = 0; i < CHILD_CNT; i++)
+    {
+      pid_t child = exec ("child-reap");
+      if (child == PID_ERROR)
+        fail ("exec \"child-reap\" %d", i);
+      if (wait (child) != 0x42)
+        fail ("wait for child %d", i);
+    }
+  msg ("reaped %d children", CHILD_CNT);
+}
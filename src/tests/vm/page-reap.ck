@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-reap) begin
+(page-reap) reaped 8 children
+(page-reap) end
+EOF
+pass;
@@ -0,0 +1,31 @@
+/* Touches every page of a buffer in the BSS and checks that the
+   paging statistics reported by vmstat() account for it. */
+
+#include <syscall.h>
+#include <syscall-nr.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_CNT 64
+
+static char buf[PAGE_CNT * 4096];
+
+void
+test_main (void)
+{
+  int faults, resident;
+  size_t i;
+
+  faults = vmstat (VMSTAT_MINOR_FAULTS) + vmstat (VMSTAT_MAJOR_FAULTS);
+  resident = vmstat (VMSTAT_RESIDENT);
+
+  for (i = 0; i < PAGE_CNT; i++)
+    buf[i * 4096] = i;
+
+  CHECK (vmstat (VMSTAT_MINOR_FAULTS) + vmstat (VMSTAT_MAJOR_FAULTS)
+         >= faults + PAGE_CNT - 1, "faults counted");
+  CHECK (vmstat (VMSTAT_RESIDENT) >= resident + PAGE_CNT - 1,
+         "resident frames counted");
+  CHECK (vmstat (VMSTAT_EVICTIONS) >= 0, "evictions readable");
+  CHECK (vmstat (-1) == -1, "bad field rejected");
+}
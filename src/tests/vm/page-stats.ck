@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-stats) begin
+(page-stats) faults counted
+(page-stats) resident frames counted
+(page-stats) evictions readable
+(page-stats) bad field rejected
+(page-stats) end
+EOF
+pass;
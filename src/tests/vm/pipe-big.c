@@ -0,0 +1,37 @@
+/* Writes a 3 MB buffer, more than the user pool holds, to a
+   child process through a pipe in a single write(). */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/userprog/pipe-stream.h"
+
+#define SIZE (3 * 1024 * 1024)
+
+static unsigned char buf[SIZE];
+
+void
+test_main (void)
+{
+  struct spawn_action action;
+  int fds[2];
+  pid_t pid;
+  size_t i;
+
+  for (i = 0; i < SIZE; i++)
+    buf[i] = STREAM_BYTE (i);
+
+  CHECK (pipe (fds), "pipe");
+  action.type = SPAWN_DUP;
+  action.fd = fds[0];
+  action.newfd = STDIN_FILENO;
+  CHECK ((pid = spawn ("child-pipe-sink", &action, 1)) != PID_ERROR,
+         "spawn child-pipe-sink");
+  close (fds[0]);
+
+  CHECK (write (fds[1], buf, SIZE) == SIZE, "write 3 MB buffer");
+  close (fds[1]);
+
+  CHECK (wait (pid) == 0, "wait for child-pipe-sink");
+}
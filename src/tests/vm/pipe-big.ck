@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pipe-big) begin
+(pipe-big) pipe
+(pipe-big) spawn child-pipe-sink
+(pipe-big) write 3 MB buffer
+(child-pipe-sink) read 3145728 bytes
+child-pipe-sink: exit(0)
+(pipe-big) wait for child-pipe-sink
+(pipe-big) end
+pipe-big: exit(0)
+EOF
+pass;
@@ -0,0 +1,27 @@
+/* Has a child create a segment, fill it and exit, twice, then
+   opens the same name again and checks that, with every handle
+   on the old segment gone, it gets a new, zeroed one. */
+
+#include <syscall.h>
+#include "tests/vm/shm.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  char *shm = (char *) 0x10000000;
+  int shmid;
+  size_t i;
+
+  CHECK (wait (exec ("child-shm-new")) == 0, "wait for first child");
+  CHECK (wait (exec ("child-shm-new")) == 0, "wait for second child");
+
+  CHECK ((shmid = shm_open (SHM_REOPEN_NAME, SHM_SIZE)) >= 0,
+         "shm_open \"%s\"", SHM_REOPEN_NAME);
+  CHECK (shm_map (shmid, shm) == shm, "shm_map");
+  for (i = 0; i < SHM_SIZE; i++)
+    if (shm[i] != 0)
+      fail ("byte %zu is %d", i, shm[i]);
+  msg ("segment is zeroed");
+}
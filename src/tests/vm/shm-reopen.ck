@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(shm-reopen) begin
+(child-shm-new) begin
+(child-shm-new) segment filled
+(child-shm-new) end
+(shm-reopen) wait for first child
+(child-shm-new) begin
+(child-shm-new) segment filled
+(child-shm-new) end
+(shm-reopen) wait for second child
+(shm-reopen) shm_open "shm-reopen"
+(shm-reopen) shm_map
+(shm-reopen) segment is zeroed
+(shm-reopen) end
+EOF
+pass;
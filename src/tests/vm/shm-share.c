@@ -0,0 +1,30 @@
+/* Maps a shared memory segment, has a child map the same segment
+   at another address and check what the parent wrote there, and
+   checks the child's reply once it has exited. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/shm.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  char *shm = (char *) 0x10000000;
+  int shmid;
+  size_t i;
+
+  CHECK ((shmid = shm_open (SHM_NAME, SHM_SIZE)) >= 0,
+         "shm_open \"%s\"", SHM_NAME);
+  CHECK (shm_map (shmid, shm) == shm, "shm_map");
+  for (i = 0; i < SHM_SIZE; i++)
+    shm[i] = i % 251;
+  CHECK (shm_map (shmid, shm) == NULL, "shm_map twice");
+
+  CHECK (wait (exec ("child-shm")) == 0, "wait for child");
+  for (i = 0; i < SHM_SIZE; i += 4096)
+    if (strcmp (shm + i, SHM_REPLY))
+      fail ("no reply at offset %zu", i);
+  msg ("reply received");
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(shm-share) begin
+(shm-share) shm_open "shm-share"
+(shm-share) shm_map
+(shm-share) shm_map twice
+(child-shm) begin
+(child-shm) segment verified
+(child-shm) end
+(shm-share) wait for child
+(shm-share) reply received
+(shm-share) end
+EOF
+pass;
@@ -0,0 +1,14 @@
+#ifndef TESTS_VM_SHM_H
+#define TESTS_VM_SHM_H
+
+/* Segment shared by shm-share and child-shm. */
+#define SHM_NAME "shm-share"
+#define SHM_SIZE (4 * 4096)
+
+/* Segment created anew by each child-shm-new. */
+#define SHM_REOPEN_NAME "shm-reopen"
+
+/* Written by the child at the start of every page. */
+#define SHM_REPLY "child was here"
+
+#endif /* tests/vm/shm.h */
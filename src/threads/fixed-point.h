@@ -0,0 +1,60 @@
+#ifndef THREADS_FIXED_POINT_H
+#define THREADS_FIXED_POINT_H
+
+#include <stdint.h>
+
+/* Signed 17.14 fixed-point real numbers, for the 4.4BSD
+   scheduler's load_avg and recent_cpu.  The kernel does not use
+   the FPU, so these stand in for floating point.
+
+   Products and quotients of two fixed-point numbers are formed
+   in 64 bits so that the intermediate result does not
+   overflow. */
+typedef int fixed_point;
+
+#define FP_SHIFT 14                     /* Bits after the point. */
+#define FP_ONE (1 << FP_SHIFT)          /* 1.0. */
+
+/* Returns integer N as a fixed-point number. */
+static inline fixed_point
+fp_from_int (int n)
+{
+  return n * FP_ONE;
+}
+
+/* Returns X truncated toward zero. */
+static inline int
+fp_trunc (fixed_point x)
+{
+  return x / FP_ONE;
+}
+
+/* Returns X rounded to the nearest integer. */
+static inline int
+fp_round (fixed_point x)
+{
+  return x >= 0 ? (x + FP_ONE / 2) / FP_ONE : (x - FP_ONE / 2) / FP_ONE;
+}
+
+/* Returns X + N for integer N. */
+static inline fixed_point
+fp_add_int (fixed_point x, int n)
+{
+  return x + n * FP_ONE;
+}
+
+/* Returns X * Y. */
+static inline fixed_point
+fp_mul (fixed_point x, fixed_point y)
+{
+  return ((int64_t) x) * y / FP_ONE;
+}
+
+/* Returns X / Y. */
+static inline fixed_point
+fp_div (fixed_point x, fixed_point y)
+{
+  return ((int64_t) x) * FP_ONE / y;
+}
+
+#endif /* threads/fixed-point.h */
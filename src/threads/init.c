@@ -37,6 +37,11 @@
 #include "filesys/filesys.h"
 #include "filesys/fsutil.h"
 #endif
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/shm.h"
+#include "vm/swap.h"
+#endif
 
 /* Page directory with kernel mappings only. */
 uint32_t *init_page_dir;
@@ -113,10 +118,12 @@ main (void)
 #ifdef USERPROG
   exception_init ();
   syscall_init ();
+  process_init ();
 #endif
 
   /* Start thread scheduler and enable interrupts. */
   thread_start ();
+  timer_init_softirq ();
   serial_init_queue ();
   timer_calibrate ();
 
@@ -126,6 +133,11 @@ main (void)
   locate_block_devices ();
   filesys_init (format_filesys);
 #endif
+#ifdef VM
+  init_table ();
+  swap_init ();
+  shm_init ();
+#endif
 
   printf ("Boot complete.\n");
   
@@ -251,11 +263,37 @@ parse_options (char **argv)
       else if (!strcmp (name, "-swap"))
         swap_bdev_name = value;
 #endif
+#endif
+#ifdef VM
+      else if (!strcmp (name, "-vmstats"))
+        vm_print_stats = true;
+      else if (!strcmp (name, "-zswap"))
+        zswap_pages = atoi (value);
 #endif
       else if (!strcmp (name, "-rs"))
         random_init (atoi (value));
       else if (!strcmp (name, "-mlfqs"))
         thread_mlfqs = true;
+      else if (!strcmp (name, "-stride"))
+        thread_stride = true;
+      else if (!strcmp (name, "-slice"))
+        {
+          int slice = atoi (value);
+          if (slice < 1)
+            PANIC ("time slice must be at least 1 tick");
+          thread_time_slice = slice;
+        }
+      else if (!strcmp (name, "-hz"))
+        {
+          timer_freq = atoi (value);
+          if (timer_freq < TIMER_FREQ_MIN || timer_freq > TIMER_FREQ_MAX)
+            PANIC ("timer frequency must be between %d and %d Hz",
+                   TIMER_FREQ_MIN, TIMER_FREQ_MAX);
+        }
+      else if (!strcmp (name, "-tickless"))
+        timer_tickless = true;
+      else if (!strcmp (name, "-schedstats"))
+        thread_sched_stats = true;
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
@@ -264,6 +302,9 @@ parse_options (char **argv)
         PANIC ("unknown option `%s' (use -h for help)", name);
     }
 
+  if (thread_mlfqs && thread_stride)
+    PANIC ("-mlfqs and -stride are mutually exclusive");
+
   /* Initialize the random number generator based on the system
      time.  This has no effect if an "-rs" option was specified.
 
@@ -379,8 +420,17 @@ usage (void)
 #endif
           "  -rs=SEED           Set random number seed to SEED.\n"
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+          "  -stride            Use stride (proportional-share) scheduler.\n"
+          "  -slice=TICKS       Preempt threads after TICKS timer ticks.\n"
+          "  -hz=FREQ           Take FREQ timer interrupts per second.\n"
+          "  -tickless          Stop the timer interrupt while idle.\n"
+          "  -schedstats        Time run-queue delays and CPU use.\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
+#endif
+#ifdef VM
+          "  -vmstats           Print paging statistics at process exit.\n"
+          "  -zswap=PAGES       Compress up to PAGES pages of swap in RAM.\n"
 #endif
           );
   shutdown_power_off ();
@@ -9,6 +9,10 @@
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "devices/timer.h"
+#ifdef USERPROG
+#include "userprog/gdt.h"
+#include "userprog/process.h"
+#endif
 
 /* Programmable Interrupt Controller (PIC) registers.
    A PC has two PICs, called the master and slave PICs, with the
@@ -384,7 +388,15 @@ intr_handler (struct intr_frame *frame)
       pic_end_of_interrupt (frame->vec_no); 
 
       if (yield_on_return) 
-        thread_yield (); 
+        {
+          thread_yield (); 
+#ifdef USERPROG
+          /* Catches threads of an exiting process that make no
+             system calls. */
+          if (frame->cs == SEL_UCSEG)
+            process_check_exit ();
+#endif
+        }
     }
 }
 
@@ -148,6 +148,60 @@ palloc_free_page (void *page)
   palloc_free_multiple (page, 1);
 }
 
+/* Frees the PAGE_CNT pages, not necessarily contiguous, whose
+   addresses are in PAGES.  All of them must come from the same
+   pool, whose lock is taken once for the lot. */
+void
+palloc_free_batch (void *pages[], size_t page_cnt)
+{
+  struct pool *pool;
+  size_t i;
+
+  if (page_cnt == 0)
+    return;
+
+  if (page_from_pool (&kernel_pool, pages[0]))
+    pool = &kernel_pool;
+  else if (page_from_pool (&user_pool, pages[0]))
+    pool = &user_pool;
+  else
+    NOT_REACHED ();
+
+  lock_acquire (&pool->lock);
+  for (i = 0; i < page_cnt; i++)
+    {
+      size_t page_idx = pg_no (pages[i]) - pg_no (pool->base);
+
+      ASSERT (pg_ofs (pages[i]) == 0);
+      ASSERT (page_from_pool (pool, pages[i]));
+#ifndef NDEBUG
+      memset (pages[i], 0xcc, PGSIZE);
+#endif
+      ASSERT (bitmap_test (pool->used_map, page_idx));
+      bitmap_reset (pool->used_map, page_idx);
+    }
+  lock_release (&pool->lock);
+}
+
+/* Returns the number of pages in the user pool. */
+size_t
+palloc_user_page_cnt (void)
+{
+  return bitmap_size (user_pool.used_map);
+}
+
+/* Returns the index of user pool page PAGE within the user pool,
+   counting from 0 at the pool's base.  PAGE must have been
+   obtained with PAL_USER. */
+size_t
+palloc_user_page_idx (const void *page)
+{
+  ASSERT (pg_ofs (page) == 0);
+  ASSERT (page_from_pool (&user_pool, (void *) page));
+
+  return pg_no (page) - pg_no (user_pool.base);
+}
+
 /* Initializes pool P as starting at START and ending at END,
    naming it NAME for debugging purposes. */
 static void
@@ -32,6 +32,13 @@
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 
+/* Maximum length of a chain of lock holders that a donated
+   priority is passed along.  Deeper chains are rare and bounding
+   the walk bounds the time spent with interrupts off. */
+#define DONATION_DEPTH 8
+
+static void donate_priority (struct thread *);
+
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
    manipulating it:
@@ -66,10 +73,9 @@ sema_down (struct semaphore *sema)
   ASSERT (!intr_context ());
 
   old_level = intr_disable ();
-  while (sema->value == 0 || (!list_empty (&sema->waiters) && !(thread_current ()->once_waited)))
+  while (sema->value == 0)
     {
       list_push_back (&sema->waiters, &thread_current ()->elem);
-      thread_current ()->once_waited = true;
       thread_block ();
     }
   sema->value--;
@@ -102,8 +108,21 @@ sema_try_down (struct semaphore *sema)
   return success;
 }
 
+/* Returns true if thread A has lower priority than thread B,
+   for list_max() over wait lists. */
+static bool
+priority_less (const struct list_elem *a_, const struct list_elem *b_,
+               void *aux UNUSED)
+{
+  const struct thread *a = list_entry (a_, struct thread, elem);
+  const struct thread *b = list_entry (b_, struct thread, elem);
+
+  return a->priority < b->priority;
+}
+
 /* Up or "V" operation on a semaphore.  Increments SEMA's value
-   and wakes up one thread of those waiting for SEMA, if any.
+   and wakes up the highest-priority thread of those waiting for
+   SEMA, if any, yielding to it if it outranks the caller.
 
    This function may be called from an interrupt handler. */
 void
@@ -114,12 +133,17 @@ sema_up (struct semaphore *sema)
   ASSERT (sema != NULL);
 
   old_level = intr_disable ();
-  if (!list_empty (&sema->waiters))
-    thread_unblock (list_entry (list_pop_front (&sema->waiters),
-                                struct thread, elem));
   sema->value++;
-  thread_current() -> once_waited = false;
+  if (!list_empty (&sema->waiters))
+    {
+      /* Priorities may change while threads wait, so search
+         rather than keeping the list sorted. */
+      struct list_elem *e = list_max (&sema->waiters, priority_less, NULL);
+      list_remove (e);
+      thread_unblock (list_entry (e, struct thread, elem));
+    }
   intr_set_level (old_level);
+  thread_preempt ();
 }
 
 static void sema_test_helper (void *sema_);
@@ -187,6 +211,12 @@ lock_init (struct lock *lock)
    necessary.  The lock must not already be held by the current
    thread.
 
+   While waiting, the current thread donates its priority to the
+   holder of LOCK, and on through the lock that holder is waiting
+   for, and so on, up to DONATION_DEPTH holders.  The holder gives
+   the donation back in lock_release().  There is no donation
+   under the MLFQS scheduler.
+
    This function may sleep, so it must not be called within an
    interrupt handler.  This function may be called with
    interrupts disabled, but interrupts will be turned back on if
@@ -194,12 +224,42 @@ lock_init (struct lock *lock)
 void
 lock_acquire (struct lock *lock)
 {
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
   ASSERT (lock != NULL);
   ASSERT (!intr_context ());
   ASSERT (!lock_held_by_current_thread (lock));
 
+  old_level = intr_disable ();
+  if (lock->holder != NULL && !thread_mlfqs)
+    {
+      cur->waiting_lock = lock;
+      list_push_back (&lock->holder->donors, &cur->donor_elem);
+      donate_priority (cur);
+    }
   sema_down (&lock->semaphore);
-  lock->holder = thread_current ();
+  cur->waiting_lock = NULL;
+  lock->holder = cur;
+  intr_set_level (old_level);
+}
+
+/* Passes T's priority along the chain of holders of the locks
+   that T, and then each holder in turn, is waiting for.
+   Interrupts must be off. */
+static void
+donate_priority (struct thread *t)
+{
+  int depth;
+
+  for (depth = 0; depth < DONATION_DEPTH && t->waiting_lock != NULL; depth++)
+    {
+      struct thread *holder = t->waiting_lock->holder;
+      if (holder == NULL || holder->priority >= t->priority)
+        break;
+      thread_donate_priority (holder, t->priority);
+      t = holder;
+    }
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -230,11 +290,30 @@ lock_try_acquire (struct lock *lock)
 void
 lock_release (struct lock *lock)
 {
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+  struct list_elem *e;
+
   ASSERT (lock != NULL);
   ASSERT (lock_held_by_current_thread (lock));
 
+  /* Take back the donations made for LOCK. */
+  old_level = intr_disable ();
+  e = list_begin (&cur->donors);
+  while (e != list_end (&cur->donors))
+    {
+      struct thread *donor = list_entry (e, struct thread, donor_elem);
+      if (donor->waiting_lock == lock)
+        e = list_remove (e);
+      else
+        e = list_next (e);
+    }
+  thread_refresh_priority (cur);
+
   lock->holder = NULL;
   sema_up (&lock->semaphore);
+  intr_set_level (old_level);
+  thread_preempt ();
 }
 
 /* Returns true if the current thread holds LOCK, false
@@ -253,8 +332,21 @@ struct semaphore_elem
   {
     struct list_elem elem;              /* List element. */
     struct semaphore semaphore;         /* This semaphore. */
+    struct thread *thread;              /* Thread waiting on it. */
   };
 
+/* Returns true if the thread waiting on semaphore_elem A has
+   lower priority than the one waiting on B. */
+static bool
+waiter_less (const struct list_elem *a_, const struct list_elem *b_,
+             void *aux UNUSED)
+{
+  const struct semaphore_elem *a = list_entry (a_, struct semaphore_elem, elem);
+  const struct semaphore_elem *b = list_entry (b_, struct semaphore_elem, elem);
+
+  return a->thread->priority < b->thread->priority;
+}
+
 /* Initializes condition variable COND.  A condition variable
    allows one piece of code to signal a condition and cooperating
    code to receive the signal and act upon it. */
@@ -297,6 +389,7 @@ cond_wait (struct condition *cond, struct lock *lock)
   ASSERT (lock_held_by_current_thread (lock));
 
   sema_init (&waiter.semaphore, 0);
+  waiter.thread = thread_current ();
   list_push_back (&cond->waiters, &waiter.elem);
   lock_release (lock);
   sema_down (&waiter.semaphore);
@@ -304,7 +397,8 @@ cond_wait (struct condition *cond, struct lock *lock)
 }
 
 /* If any threads are waiting on COND (protected by LOCK), then
-   this function signals one of them to wake up from its wait.
+   this function signals the highest-priority one to wake up from
+   its wait.
    LOCK must be held before calling this function.
 
    An interrupt handler cannot acquire a lock, so it does not
@@ -319,8 +413,11 @@ cond_signal (struct condition *cond, struct lock *lock UNUSED)
   ASSERT (lock_held_by_current_thread (lock));
 
   if (!list_empty (&cond->waiters))
-    sema_up (&list_entry (list_pop_front (&cond->waiters),
-                          struct semaphore_elem, elem)->semaphore);
+    {
+      struct list_elem *e = list_max (&cond->waiters, waiter_less, NULL);
+      list_remove (e);
+      sema_up (&list_entry (e, struct semaphore_elem, elem)->semaphore);
+    }
 }
 
 /* Wakes up all threads, if any, waiting on COND (protected by
@@ -1,19 +1,26 @@
 #include "threads/thread.h"
 #include <debug.h>
+#include <hash.h>
 #include <stddef.h>
 #include <random.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/fixed-point.h"
 #include "threads/flags.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/switch.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
+#include "devices/timer.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #endif
+#ifdef VM
+#include "vm/frame.h"
+#endif
 
 /* Random value for struct thread's `magic' member.
    Used to detect stack overflow.  See the big comment at the top
@@ -22,9 +29,15 @@
 
 static struct list all_list;
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
+/* Processes in THREAD_READY state, that is, processes that are
+   ready to run but not actually running, with one FIFO queue per
+   priority.  Bit P of ready_bitmap is set iff ready_queues[P] is
+   nonempty, so the highest ready priority is one bit scan. */
+#define PRI_CNT (PRI_MAX - PRI_MIN + 1)
+#define READY_WORDS ((PRI_CNT + 31) / 32)
+static struct list ready_queues[PRI_CNT];
+static uint32_t ready_bitmap[READY_WORDS];
+static int ready_cnt;           /* # of threads in ready_queues. */
 
 /* List of all processes.  Processes are added to this list
    when they are first scheduled and removed when they exit. */
@@ -36,6 +49,28 @@ static struct thread *idle_thread;
 /* Initial thread, the thread running init.c:main(). */
 static struct thread *initial_thread;
 
+/* Pages of dead threads kept for reuse, to save thread_create()
+   the page allocator's lock and bitmap scan and the zeroing of a
+   whole page: init_thread() clears the struct thread, and the
+   stack above it needs no clearing.  The list element sits at
+   the bottom of each page.  Only touched with interrupts off. */
+#define THREAD_PAGE_CACHE_MAX 32
+unsigned thread_page_cache_max = THREAD_PAGE_CACHE_MAX;
+static struct list thread_page_cache;
+static unsigned thread_page_cache_cnt;
+static long long thread_pages_reused;   /* # of pages from the cache. */
+static long long thread_pages_allocated; /* # of pages from palloc. */
+
+/* Live threads by tid, for tid_to_thread().  Needs malloc(), so
+   it is set up by thread_start(); until then it is empty and only
+   the initial thread exists. */
+static struct hash tid_hash;
+static bool tid_hash_ready;
+static struct lock tid_hash_lock;
+
+static hash_hash_func tid_hash_func;
+static hash_less_func tid_less;
+
 /* Lock used by allocate_tid(). */
 static struct lock tid_lock;
 
@@ -52,26 +87,100 @@ static long long idle_ticks;    /* # of timer ticks spent idle. */
 static long long kernel_ticks;  /* # of timer ticks in kernel threads. */
 static long long user_ticks;    /* # of timer ticks in user programs. */
 
+/* Scheduler latency statistics, in the same form as the
+   per-thread ones in struct thread.
+
+   Reading the time costs several slow PIT port accesses (see
+   timer_usecs()), too much for every switch, so the delays and
+   CPU times are recorded only if thread_sched_stats.  Switches
+   are always counted. */
+bool thread_sched_stats;
+static long long voluntary_switches;  /* Switches away from a thread
+                                         that blocked or yielded. */
+static long long preempted_switches;  /* Switches away from a thread
+                                         that was preempted. */
+static unsigned delay_hist[SCHED_HIST_BUCKETS]; /* Run-queue delays. */
+
+/* Set when the next thread_yield() is a preemption rather than
+   the running thread's own choice. */
+static bool yield_preempts;
+
 /* Scheduling. */
-#define TIME_SLICE 4            /* # of timer ticks to give each thread. */
+#define TIME_SLICE 4            /* Default # of timer ticks per thread. */
+unsigned thread_time_slice = TIME_SLICE;
 static unsigned thread_ticks;   /* # of timer ticks since last yield. */
 
+#ifdef VM
+/* Working set sampling. */
+#define WSS_INTERVAL 100        /* # of timer ticks between samples. */
+static unsigned wss_ticks;      /* # of timer ticks since last sample. */
+#endif
+
 /* If false (default), use round-robin scheduler.
    If true, use multi-level feedback queue scheduler.
    Controlled by kernel command-line option "-o mlfqs". */
 bool thread_mlfqs;
 
+/* 4.4BSD scheduler.
+
+   A thread's priority depends only on its nice and recent_cpu,
+   and between the once-a-second updates of every thread's
+   recent_cpu, only the running thread's recent_cpu moves.  So
+   rather than recomputing every priority every fourth tick, we
+   recompute the running thread's every fourth tick and when it
+   stops running, and everyone's once a second.  The per-tick
+   cost is then constant in the number of threads. */
+#define MLFQS_PRIORITY_INTERVAL 4 /* # of ticks between recomputes. */
+static fixed_point load_avg;    /* System load average. */
+
+/* Stride scheduler.
+
+   Every tick a thread runs advances its pass by its stride,
+   STRIDE1 / tickets, and the ready thread with the least pass
+   runs next, so over time threads get the CPU in proportion to
+   their tickets.  Ready threads sit in a binary min-heap on
+   pass, in place of the run queues.  A thread that becomes
+   ready starts no earlier than global_pass, the pass of the
+   thread most recently scheduled, so that time spent blocked
+   does not build up credit. */
+bool thread_stride;
+
+#define STRIDE1 (1 << 20)       /* Stride of a single ticket. */
+#define STRIDE_HEAP_MAX 2048    /* Most ready threads. */
+static struct thread *stride_heap[STRIDE_HEAP_MAX];
+static int stride_heap_cnt;
+static int64_t global_pass;
+
+static void stride_heap_insert (struct thread *);
+static void stride_heap_remove (struct thread *);
+static void stride_heap_sift_up (int idx);
+static void stride_heap_sift_down (int idx);
+static void stride_heap_swap (int i, int j);
+
+static void mlfqs_tick (struct thread *);
+static void mlfqs_update_recent_cpu (struct thread *, void *aux);
+static void mlfqs_update_priority (struct thread *, void *aux);
+
 static void kernel_thread (thread_func *, void *aux);
 
 static void idle (void *aux UNUSED);
 static struct thread *running_thread (void);
 static struct thread *next_thread_to_run (void);
+static void ready_push (struct thread *);
+static int ready_max_priority (void);
+static void ready_remove (struct thread *);
+static void change_priority (struct thread *, int priority);
+static int delay_bucket (int64_t usecs);
+static unsigned *alloc_delay_hist (void);
+static void print_delay_hist (const unsigned hist[SCHED_HIST_BUCKETS]);
 static void init_thread (struct thread *, const char *name, int priority);
 static bool is_thread (struct thread *) UNUSED;
 static void *alloc_frame (struct thread *, size_t size);
 static void schedule (void);
 void thread_schedule_tail (struct thread *prev);
 static tid_t allocate_tid (void);
+static struct thread *thread_page_get (void);
+static void thread_page_put (struct thread *);
 
 /* Initializes the threading system by transforming the code
    that's currently running into a thread.  This can't work in
@@ -91,16 +200,20 @@ thread_init (void)
 {
   ASSERT (intr_get_level () == INTR_OFF);
 
+  int pri;
+
   lock_init (&tid_lock);
-  list_init (&ready_list);
+  lock_init (&tid_hash_lock);
+  for (pri = PRI_MIN; pri <= PRI_MAX; pri++)
+    list_init (&ready_queues[pri]);
   list_init (&all_list);
+  list_init (&thread_page_cache);
 
   /* Set up a thread structure for the running thread. */
   initial_thread = running_thread ();
   init_thread (initial_thread, "main", PRI_DEFAULT);
   initial_thread->status = THREAD_RUNNING;
   initial_thread->tid = allocate_tid ();
-  initial_thread-> once_waited = false;
 }
 
 /* Starts preemptive thread scheduling by enabling interrupts.
@@ -108,8 +221,16 @@ thread_init (void)
 void
 thread_start (void)
 {
-  /* Create the idle thread. */
   struct semaphore idle_started;
+
+  /* Index the initial thread by tid. */
+  if (!hash_init (&tid_hash, tid_hash_func, tid_less, NULL))
+    PANIC ("cannot allocate thread table");
+  hash_insert (&tid_hash, &initial_thread->tid_elem);
+  tid_hash_ready = true;
+  initial_thread->delay_hist = alloc_delay_hist ();
+
+  /* Create the idle thread. */
   sema_init (&idle_started, 0);
   thread_create ("idle", PRI_MIN, idle, &idle_started);
 
@@ -137,17 +258,221 @@ thread_tick (void)
   else
     kernel_ticks++;
 
+#ifdef VM
+  /* Sample the running process's working set. */
+  if (++wss_ticks >= WSS_INTERVAL)
+    {
+      wss_ticks = 0;
+      if (t->pagedir != NULL)
+        frame_sample_working_set (t->process);
+    }
+#endif
+
+  if (thread_mlfqs)
+    mlfqs_tick (t);
+  else if (thread_stride && t != idle_thread)
+    t->pass += STRIDE1 / t->tickets;
+
   /* Enforce preemption. */
-  if (++thread_ticks >= TIME_SLICE)
-    intr_yield_on_return ();
+  if (++thread_ticks >= thread_time_slice)
+    {
+      yield_preempts = true;
+      intr_yield_on_return ();
+    }
 }
 
-/* Prints thread statistics. */
+/* Charges CNT timer ticks that passed without a timer interrupt,
+   while the CPU was idle in tickless mode, to the idle thread.
+   Called by the timer with interrupts off. */
+void
+thread_idle_ticks (int64_t cnt)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  idle_ticks += cnt;
+#ifdef VM
+  /* The idle thread has no working set to sample. */
+  wss_ticks = (wss_ticks + cnt) % WSS_INTERVAL;
+#endif
+}
+
+/* Does the 4.4BSD scheduler's per-tick bookkeeping for T, the
+   running thread. */
+static void
+mlfqs_tick (struct thread *t)
+{
+  int64_t now = timer_ticks ();
+
+  if (t != idle_thread)
+    t->recent_cpu = fp_add_int (t->recent_cpu, 1);
+
+  if (now % TIMER_FREQ == 0)
+    {
+      int ready_threads = ready_cnt + (t != idle_thread);
+
+      load_avg = fp_mul (fp_div (fp_from_int (59), fp_from_int (60)),
+                         load_avg)
+                 + fp_from_int (ready_threads) / 60;
+      thread_foreach (mlfqs_update_recent_cpu, NULL);
+      thread_foreach (mlfqs_update_priority, NULL);
+      thread_preempt ();
+    }
+  else if (now % MLFQS_PRIORITY_INTERVAL == 0)
+    {
+      mlfqs_update_priority (t, NULL);
+      thread_preempt ();
+    }
+}
+
+/* Decays T's recent_cpu by the load average and adds its
+   nice. */
+static void
+mlfqs_update_recent_cpu (struct thread *t, void *aux UNUSED)
+{
+  fixed_point twice_load = load_avg * 2;
+
+  if (t == idle_thread)
+    return;
+  t->recent_cpu = fp_add_int (fp_mul (fp_div (twice_load,
+                                               fp_add_int (twice_load, 1)),
+                                      t->recent_cpu),
+                              t->nice);
+}
+
+/* Recomputes T's priority from its recent_cpu and nice. */
+static void
+mlfqs_update_priority (struct thread *t, void *aux UNUSED)
+{
+  int priority;
+
+  if (t == idle_thread)
+    return;
+  priority = PRI_MAX - fp_trunc (t->recent_cpu / 4) - t->nice * 2;
+  if (priority < PRI_MIN)
+    priority = PRI_MIN;
+  else if (priority > PRI_MAX)
+    priority = PRI_MAX;
+  t->base_priority = priority;
+  change_priority (t, priority);
+}
+
+/* Per-thread statistics copied out by thread_print_stats(), so
+   that they can be printed with interrupts on.  Static, because
+   the statistics are also printed on a kernel panic. */
+#define THREAD_STATS_MAX 64
+struct thread_stats
+  {
+    char name[16];
+    tid_t tid;
+    int64_t cpu_usecs;
+    unsigned voluntary_switches;
+    unsigned preempted_switches;
+    bool has_hist;
+    unsigned delay_hist[SCHED_HIST_BUCKETS];
+  };
+static struct thread_stats thread_stats[THREAD_STATS_MAX];
+
+/* Prints thread statistics.  Per-thread figures are printed only
+   with -schedstats. */
 void
 thread_print_stats (void)
 {
+  struct list_elem *e;
+  enum intr_level old_level;
+  size_t cnt = 0, total = 0;
+  size_t i;
+
   printf ("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
           idle_ticks, kernel_ticks, user_ticks);
+  printf ("Thread: %lld pages allocated, %lld reused\n",
+          thread_pages_allocated, thread_pages_reused);
+  printf ("Thread: %lld context switches, %lld voluntary, %lld preempted\n",
+          voluntary_switches + preempted_switches,
+          voluntary_switches, preempted_switches);
+  if (!thread_sched_stats)
+    return;
+  printf ("Thread: run-queue delay histogram\n");
+  print_delay_hist (delay_hist);
+
+  old_level = intr_disable ();
+  for (e = list_begin (&all_list); e != list_end (&all_list);
+       e = list_next (e))
+    {
+      struct thread *t = list_entry (e, struct thread, allelem);
+      struct thread_stats *ts;
+
+      total++;
+      if (cnt >= THREAD_STATS_MAX)
+        continue;
+      ts = &thread_stats[cnt];
+      strlcpy (ts->name, t->name, sizeof ts->name);
+      ts->tid = t->tid;
+      ts->cpu_usecs = t->cpu_usecs;
+      ts->voluntary_switches = t->voluntary_switches;
+      ts->preempted_switches = t->preempted_switches;
+      ts->has_hist = t->delay_hist != NULL;
+      if (ts->has_hist)
+        memcpy (ts->delay_hist, t->delay_hist, sizeof ts->delay_hist);
+      cnt++;
+    }
+  intr_set_level (old_level);
+
+  for (i = 0; i < cnt; i++)
+    {
+      struct thread_stats *ts = &thread_stats[i];
+      printf ("Thread %s (tid %d): %lld us CPU, "
+              "%u voluntary and %u preempted switches\n",
+              ts->name, ts->tid, ts->cpu_usecs,
+              ts->voluntary_switches, ts->preempted_switches);
+      if (ts->has_hist)
+        print_delay_hist (ts->delay_hist);
+    }
+  if (total > cnt)
+    printf ("Thread: %zu more threads not shown\n", total - cnt);
+}
+
+/* Returns the histogram bucket for a run-queue delay of
+   USECS. */
+static int
+delay_bucket (int64_t usecs)
+{
+  int bucket = 0;
+
+  while (usecs > 0 && bucket < SCHED_HIST_BUCKETS - 1)
+    {
+      usecs >>= 1;
+      bucket++;
+    }
+  return bucket;
+}
+
+/* Returns a zeroed per-thread run-queue delay histogram, or a
+   null pointer if thread_sched_stats is off or memory is short.
+   It lives apart from struct thread to save kernel stack. */
+static unsigned *
+alloc_delay_hist (void)
+{
+  if (!thread_sched_stats)
+    return NULL;
+  return calloc (SCHED_HIST_BUCKETS, sizeof (unsigned));
+}
+
+/* Prints the nonempty buckets of run-queue delay histogram
+   HIST. */
+static void
+print_delay_hist (const unsigned hist[SCHED_HIST_BUCKETS])
+{
+  int b;
+
+  for (b = 0; b < SCHED_HIST_BUCKETS; b++)
+    if (hist[b] != 0)
+      {
+        long long lo = b == 0 ? 0 : 1LL << (b - 1);
+        if (b == SCHED_HIST_BUCKETS - 1)
+          printf ("  %8lld us and up: %u\n", lo, hist[b]);
+        else
+          printf ("  %8lld-%lld us: %u\n", lo, (1LL << b) - 1, hist[b]);
+      }
 }
 
 /* Creates a new kernel thread named NAME with the given initial
@@ -162,9 +487,8 @@ thread_print_stats (void)
    scheduled.  Use a semaphore or some other form of
    synchronization if you need to ensure ordering.
 
-   The code provided sets the new thread's `priority' member to
-   PRIORITY, but no actual priority scheduling is implemented.
-   Priority scheduling is the goal of Problem 1-3. */
+   If the new thread has a higher priority than the running
+   thread, it runs before thread_create() returns. */
 tid_t
 thread_create (const char *name, int priority,
                thread_func *function, void *aux)
@@ -179,13 +503,17 @@ thread_create (const char *name, int priority,
   ASSERT (function != NULL);
 
   /* Allocate thread. */
-  t = palloc_get_page (PAL_ZERO);
+  t = thread_page_get ();
   if (t == NULL)
     return TID_ERROR;
 
   /* Initialize thread. */
   init_thread (t, name, priority);
   tid = t->tid = allocate_tid ();
+  t->delay_hist = alloc_delay_hist ();
+  lock_acquire (&tid_hash_lock);
+  hash_insert (&tid_hash, &t->tid_elem);
+  lock_release (&tid_hash_lock);
 
   /* Prepare thread for first run by initializing its stack.
      Do this atomically so intermediate values for the 'stack'
@@ -235,10 +563,14 @@ thread_block (void)
    This is an error if T is not blocked.  (Use thread_yield() to
    make the running thread ready.)
 
-   This function does not preempt the running thread.  This can
-   be important: if the caller had disabled interrupts itself,
-   it may expect that it can atomically unblock a thread and
-   update other data. */
+   If T has a higher priority than the running thread, the
+   running thread is preempted, but only if interrupts were on
+   or we are in an interrupt handler, in which case the switch
+   happens on return from the interrupt.  This can be
+   important: if the caller had disabled interrupts itself, it
+   may expect that it can atomically unblock a thread and update
+   other data.  Such callers should call thread_preempt() once
+   they are done. */
 void
 thread_unblock (struct thread *t)
 {
@@ -248,9 +580,14 @@ thread_unblock (struct thread *t)
 
   old_level = intr_disable ();
   ASSERT (t->status == THREAD_BLOCKED);
-  list_push_back (&ready_list, &t->elem);
+  ready_push (t);
   t->status = THREAD_READY;
+  if (thread_sched_stats)
+    t->ready_stamp = timer_usecs ();
   intr_set_level (old_level);
+
+  if (old_level == INTR_ON || intr_context ())
+    thread_preempt ();
 }
 
 /* Returns the name of the running thread. */
@@ -291,12 +628,24 @@ thread_tid (void)
 void
 thread_exit (void)
 {
+  unsigned *hist;
+
   ASSERT (!intr_context ());
 
 #ifdef USERPROG
   process_exit ();
 #endif
 
+  lock_acquire (&tid_hash_lock);
+  hash_delete (&tid_hash, &thread_current ()->tid_elem);
+  lock_release (&tid_hash_lock);
+
+  /* Drop our delay histogram before freeing it, since we may
+     still be switched out and back in. */
+  hist = thread_current ()->delay_hist;
+  thread_current ()->delay_hist = NULL;
+  free (hist);
+
   /* Remove thread from all threads list, set our status to dying,
      and schedule another process.  That process will destroy us
      when it calls thread_schedule_tail(). */
@@ -319,12 +668,46 @@ thread_yield (void)
 
   old_level = intr_disable ();
   if (cur != idle_thread)
-    list_push_back (&ready_list, &cur->elem);
+    ready_push (cur);
   cur->status = THREAD_READY;
+  if (thread_sched_stats)
+    cur->ready_stamp = timer_usecs ();
   schedule ();
   intr_set_level (old_level);
 }
 
+/* Yields the CPU if a ready thread has a higher priority than
+   the running thread.  In an interrupt handler, yields on
+   return from the interrupt instead.  Does nothing if
+   interrupts are off, since the caller may be relying on
+   that for atomicity; the next timer tick will catch up.
+   The stride scheduler only switches threads at the end of a
+   time slice, so this does nothing under it. */
+void
+thread_preempt (void)
+{
+  if (thread_stride)
+    return;
+  if (intr_context ())
+    {
+      if (ready_max_priority () > thread_current ()->priority)
+        {
+          yield_preempts = true;
+          intr_yield_on_return ();
+        }
+    }
+  else if (intr_get_level () == INTR_ON)
+    {
+      enum intr_level old_level = intr_disable ();
+      bool yield = ready_max_priority () > thread_current ()->priority;
+      if (yield)
+        yield_preempts = true;
+      intr_set_level (old_level);
+      if (yield)
+        thread_yield ();
+    }
+}
+
 /* Invoke function 'func' on all threads, passing along 'aux'.
    This function must be called with interrupts off. */
 void
@@ -342,11 +725,75 @@ thread_foreach (thread_action_func *func, void *aux)
     }
 }
 
-/* Sets the current thread's priority to NEW_PRIORITY. */
+/* Sets the current thread's base priority to NEW_PRIORITY, and
+   yields if that leaves a ready thread with higher priority.
+   A priority donated to the thread is kept until it is
+   released.  Ignored under the 4.4BSD scheduler, which sets
+   priorities itself. */
 void
 thread_set_priority (int new_priority)
 {
-  thread_current ()->priority = new_priority;
+  enum intr_level old_level;
+
+  ASSERT (PRI_MIN <= new_priority && new_priority <= PRI_MAX);
+
+  if (thread_mlfqs)
+    return;
+  old_level = intr_disable ();
+  thread_current ()->base_priority = new_priority;
+  thread_refresh_priority (thread_current ());
+  intr_set_level (old_level);
+  thread_preempt ();
+}
+
+/* Raises T's effective priority to PRIORITY, if that is higher,
+   on behalf of a thread waiting for a lock that T holds.
+   Interrupts must be off. */
+void
+thread_donate_priority (struct thread *t, int priority)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (priority > t->priority)
+    change_priority (t, priority);
+}
+
+/* Recomputes T's effective priority as the highest of its base
+   priority and the priorities of the threads in its donors
+   list.  Interrupts must be off. */
+void
+thread_refresh_priority (struct thread *t)
+{
+  int priority = t->base_priority;
+  struct list_elem *e;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  for (e = list_begin (&t->donors); e != list_end (&t->donors);
+       e = list_next (e))
+    {
+      struct thread *donor = list_entry (e, struct thread, donor_elem);
+      if (donor->priority > priority)
+        priority = donor->priority;
+    }
+  change_priority (t, priority);
+}
+
+/* Sets T's effective priority to PRIORITY, moving it to the
+   matching run queue if it is ready. */
+static void
+change_priority (struct thread *t, int priority)
+{
+  if (t->priority == priority)
+    return;
+  if (t->status == THREAD_READY && t != idle_thread)
+    {
+      ready_remove (t);
+      t->priority = priority;
+      ready_push (t);
+    }
+  else
+    t->priority = priority;
 }
 
 /* Returns the current thread's priority. */
@@ -356,37 +803,67 @@ thread_get_priority (void)
   return thread_current ()->priority;
 }
 
-/* Sets the current thread's nice value to NICE. */
+/* Sets the current thread's nice value to NICE, recomputes its
+   priority and yields if it no longer has the highest. */
 void
-thread_set_nice (int nice UNUSED)
+thread_set_nice (int nice)
 {
-  /* Not yet implemented. */
+  enum intr_level old_level;
+
+  ASSERT (NICE_MIN <= nice && nice <= NICE_MAX);
+
+  old_level = intr_disable ();
+  thread_current ()->nice = nice;
+  if (thread_mlfqs)
+    mlfqs_update_priority (thread_current (), NULL);
+  intr_set_level (old_level);
+  thread_preempt ();
 }
 
 /* Returns the current thread's nice value. */
 int
 thread_get_nice (void)
 {
-  /* Not yet implemented. */
-  return 0;
+  return thread_current ()->nice;
 }
 
 /* Returns 100 times the system load average. */
 int
 thread_get_load_avg (void)
 {
-  /* Not yet implemented. */
-  return 0;
+  enum intr_level old_level = intr_disable ();
+  int load = fp_round (load_avg * 100);
+  intr_set_level (old_level);
+  return load;
 }
 
 /* Returns 100 times the current thread's recent_cpu value. */
 int
 thread_get_recent_cpu (void)
 {
-  /* Not yet implemented. */
-  return 0;
+  enum intr_level old_level = intr_disable ();
+  int recent_cpu = fp_round (thread_current ()->recent_cpu * 100);
+  intr_set_level (old_level);
+  return recent_cpu;
 }
 
+/* Returns the current thread's tickets. */
+int
+thread_get_tickets (void)
+{
+  return thread_current ()->tickets;
+}
+
+/* Sets the current thread's tickets to TICKETS, its share of the
+   CPU under the stride scheduler. */
+void
+thread_set_tickets (int tickets)
+{
+  ASSERT (TICKETS_MIN <= tickets && tickets <= TICKETS_MAX);
+
+  thread_current ()->tickets = tickets;
+}
+
 /* Idle thread.  Executes when no other thread is ready to run.
 
    The idle thread is initially put on the ready list by
@@ -394,8 +871,8 @@ thread_get_recent_cpu (void)
    point it initializes idle_thread, "up"s the semaphore passed
    to it to enable thread_start() to continue, and immediately
    blocks.  After that, the idle thread never appears in the
-   ready list.  It is returned by next_thread_to_run() as a
-   special case when the ready list is empty. */
+   run queues.  It is returned by next_thread_to_run() as a
+   special case when the run queues are empty. */
 static void
 idle (void *idle_started_ UNUSED)
 {
@@ -421,6 +898,7 @@ idle (void *idle_started_ UNUSED)
 
          See [IA32-v2a] "HLT", [IA32-v2b] "STI", and [IA32-v3a]
          7.11.1 "HLT Instruction". */
+      timer_idle ();
       asm volatile ("sti; hlt" : : : "memory");
     }
 }
@@ -470,7 +948,26 @@ init_thread (struct thread *t, const char *name, int priority)
   t->status = THREAD_BLOCKED;
   strlcpy (t->name, name, sizeof t->name);
   t->stack = (uint8_t *) t + PGSIZE;
-  t->priority = priority;
+  t->priority = t->base_priority = priority;
+  list_init (&t->donors);
+  if (t != running_thread ())
+    {
+      /* Inherit the creator's 4.4BSD state and tickets; the
+         initial thread starts from zero and the default. */
+      t->nice = running_thread ()->nice;
+      t->recent_cpu = running_thread ()->recent_cpu;
+      t->tickets = running_thread ()->tickets;
+      if (thread_mlfqs)
+        mlfqs_update_priority (t, NULL);
+    }
+  else
+    t->tickets = TICKETS_DEFAULT;
+  t->pass = global_pass;
+#ifdef USERPROG
+  list_init (&t->children);
+  list_init (&t->threads);
+  t->process = t;
+#endif
   t->magic = THREAD_MAGIC;
   list_push_back (&all_list, &t->allelem);
 }
@@ -488,18 +985,173 @@ alloc_frame (struct thread *t, size_t size)
   return t->stack;
 }
 
-/* Chooses and returns the next thread to be scheduled.  Should
-   return a thread from the run queue, unless the run queue is
-   empty.  (If the running thread can continue running, then it
-   will be in the run queue.)  If the run queue is empty, return
+/* Adds T to the back of the run queue for its priority, or to
+   the stride heap.  Interrupts must be off. */
+static void
+ready_push (struct thread *t)
+{
+  int pri = t->priority;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (thread_stride)
+    {
+      if (t->pass < global_pass)
+        t->pass = global_pass;
+      stride_heap_insert (t);
+      ready_cnt++;
+      return;
+    }
+  list_push_back (&ready_queues[pri], &t->elem);
+  ready_bitmap[pri / 32] |= (uint32_t) 1 << (pri % 32);
+  ready_cnt++;
+}
+
+/* Removes ready thread T from its run queue.  Interrupts must be
+   off. */
+static void
+ready_remove (struct thread *t)
+{
+  int pri = t->priority;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  ready_cnt--;
+  if (thread_stride)
+    {
+      stride_heap_remove (t);
+      return;
+    }
+  list_remove (&t->elem);
+  if (list_empty (&ready_queues[pri]))
+    ready_bitmap[pri / 32] &= ~((uint32_t) 1 << (pri % 32));
+}
+
+/* Returns the highest priority of any ready thread, or -1 if
+   no thread is ready.  Interrupts must be off. */
+static int
+ready_max_priority (void)
+{
+  int word;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  for (word = READY_WORDS - 1; word >= 0; word--)
+    if (ready_bitmap[word] != 0)
+      return word * 32 + 31 - __builtin_clz (ready_bitmap[word]);
+  return -1;
+}
+
+/* Chooses and returns the next thread to be scheduled: the
+   thread at the front of the highest-priority nonempty run
+   queue, or under the stride scheduler the ready thread with the
+   least pass.  (If the running thread can continue running, then
+   it will be in a run queue.)  If no thread is ready, returns
    idle_thread. */
 static struct thread *
 next_thread_to_run (void)
 {
-  if (list_empty (&ready_list))
+  int pri;
+  struct list_elem *e;
+
+  if (thread_stride)
+    {
+      struct thread *t;
+
+      if (stride_heap_cnt == 0)
+        return idle_thread;
+      t = stride_heap[0];
+      stride_heap_remove (t);
+      ready_cnt--;
+      global_pass = t->pass;
+      return t;
+    }
+
+  pri = ready_max_priority ();
+  if (pri < 0)
     return idle_thread;
-  else
-    return list_entry (list_pop_front (&ready_list), struct thread, elem);
+
+  e = list_pop_front (&ready_queues[pri]);
+  if (list_empty (&ready_queues[pri]))
+    ready_bitmap[pri / 32] &= ~((uint32_t) 1 << (pri % 32));
+  ready_cnt--;
+  return list_entry (e, struct thread, elem);
+}
+
+/* Adds T to the stride heap. */
+static void
+stride_heap_insert (struct thread *t)
+{
+  if (stride_heap_cnt >= STRIDE_HEAP_MAX)
+    PANIC ("stride scheduler: too many ready threads");
+  t->heap_idx = stride_heap_cnt++;
+  stride_heap[t->heap_idx] = t;
+  stride_heap_sift_up (t->heap_idx);
+}
+
+/* Removes T from the stride heap. */
+static void
+stride_heap_remove (struct thread *t)
+{
+  int idx = t->heap_idx;
+
+  ASSERT (idx < stride_heap_cnt && stride_heap[idx] == t);
+
+  stride_heap_cnt--;
+  if (idx == stride_heap_cnt)
+    return;
+  stride_heap[idx] = stride_heap[stride_heap_cnt];
+  stride_heap[idx]->heap_idx = idx;
+  stride_heap_sift_up (idx);
+  stride_heap_sift_down (stride_heap[idx]->heap_idx);
+}
+
+/* Swaps stride heap entries I and J. */
+static void
+stride_heap_swap (int i, int j)
+{
+  struct thread *t = stride_heap[i];
+
+  stride_heap[i] = stride_heap[j];
+  stride_heap[j] = t;
+  stride_heap[i]->heap_idx = i;
+  stride_heap[j]->heap_idx = j;
+}
+
+/* Moves stride heap entry IDX up until its parent's pass is no
+   greater. */
+static void
+stride_heap_sift_up (int idx)
+{
+  while (idx > 0)
+    {
+      int parent = (idx - 1) / 2;
+      if (stride_heap[parent]->pass <= stride_heap[idx]->pass)
+        break;
+      stride_heap_swap (parent, idx);
+      idx = parent;
+    }
+}
+
+/* Moves stride heap entry IDX down until neither child's pass is
+   less. */
+static void
+stride_heap_sift_down (int idx)
+{
+  for (;;)
+    {
+      int least = idx;
+      int child;
+
+      for (child = 2 * idx + 1; child <= 2 * idx + 2; child++)
+        if (child < stride_heap_cnt
+            && stride_heap[child]->pass < stride_heap[least]->pass)
+          least = child;
+      if (least == idx)
+        break;
+      stride_heap_swap (idx, least);
+      idx = least;
+    }
 }
 
 /* Completes a thread switch by activating the new thread's page
@@ -531,6 +1183,24 @@ thread_schedule_tail (struct thread *prev)
   /* Start new time slice. */
   thread_ticks = 0;
 
+  /* Leave tickless idle. */
+  if (cur != idle_thread)
+    timer_idle_exit ();
+
+  /* Account for the time CUR spent in the run queue.  The idle
+     thread is only "ready" in the sense that nothing else is. */
+  if (thread_sched_stats)
+    {
+      cur->run_stamp = timer_usecs ();
+      if (cur != idle_thread)
+        {
+          int bucket = delay_bucket (cur->run_stamp - cur->ready_stamp);
+          if (cur->delay_hist != NULL)
+            cur->delay_hist[bucket]++;
+          delay_hist[bucket]++;
+        }
+    }
+
 #ifdef USERPROG
   /* Activate the new address space. */
   process_activate ();
@@ -544,7 +1214,7 @@ thread_schedule_tail (struct thread *prev)
   if (prev != NULL && prev->status == THREAD_DYING && prev != initial_thread)
     {
       ASSERT (prev != cur);
-      palloc_free_page (prev);
+      thread_page_put (prev);
     }
 }
 
@@ -559,18 +1229,89 @@ static void
 schedule (void)
 {
   struct thread *cur = running_thread ();
-  struct thread *next = next_thread_to_run ();
+  struct thread *next;
   struct thread *prev = NULL;
+  bool preempted;
 
   ASSERT (intr_get_level () == INTR_OFF);
   ASSERT (cur->status != THREAD_RUNNING);
+
+  /* CUR's recent_cpu may have grown since its priority was last
+     computed.  Bring it up to date before it waits. */
+  if (thread_mlfqs && cur->status != THREAD_DYING)
+    mlfqs_update_priority (cur, NULL);
+
+  next = next_thread_to_run ();
   ASSERT (is_thread (next));
 
+  preempted = cur->status == THREAD_READY && yield_preempts;
+  yield_preempts = false;
   if (cur != next)
-    prev = switch_threads (cur, next);
+    {
+      /* Charge CUR for its run and classify the switch. */
+      if (thread_sched_stats)
+        cur->cpu_usecs += timer_usecs () - cur->run_stamp;
+      if (preempted)
+        {
+          cur->preempted_switches++;
+          preempted_switches++;
+        }
+      else
+        {
+          cur->voluntary_switches++;
+          voluntary_switches++;
+        }
+      prev = switch_threads (cur, next);
+    }
   thread_schedule_tail (prev);
 }
 
+/* Returns a page for a new thread, from the cache if possible,
+   or a null pointer if memory is exhausted.  Only the struct
+   thread part of the page is to be relied on, after
+   init_thread(). */
+static struct thread *
+thread_page_get (void)
+{
+  enum intr_level old_level = intr_disable ();
+  struct thread *t = NULL;
+
+  if (!list_empty (&thread_page_cache))
+    {
+      t = (struct thread *) list_pop_front (&thread_page_cache);
+      thread_page_cache_cnt--;
+      thread_pages_reused++;
+    }
+  intr_set_level (old_level);
+
+  if (t == NULL)
+    {
+      t = palloc_get_page (0);
+      if (t != NULL)
+        thread_pages_allocated++;
+    }
+  return t;
+}
+
+/* Releases page T of a dead thread, keeping it for reuse if
+   the cache has room.  Interrupts must be off. */
+static void
+thread_page_put (struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (thread_page_cache_cnt < thread_page_cache_max)
+    {
+      /* Clear the magic so that a stale pointer to the thread
+         fails is_thread(). */
+      t->magic = 0;
+      list_push_front (&thread_page_cache, (struct list_elem *) t);
+      thread_page_cache_cnt++;
+    }
+  else
+    palloc_free_page (t);
+}
+
 /* Returns a tid to use for a new thread. */
 static tid_t
 allocate_tid (void)
@@ -585,21 +1326,41 @@ allocate_tid (void)
   return tid;
 }
 
+/* Returns the live thread with tid FINDING_TID, or a null
+   pointer if there is none.  Unless the caller otherwise knows
+   that the thread cannot exit, it may be gone as soon as this
+   returns. */
 struct thread *
 tid_to_thread (tid_t finding_tid)
 {
-  if (list_empty(&all_list))
-    return NULL;
-  struct thread * now = list_entry(list_front(&all_list), struct thread, allelem);
-  while (now != NULL)
-  {
-    if (now -> tid == finding_tid)
-      return now;
-    if (now == list_entry(list_end(&all_list), struct thread, allelem))
-      break;
-    now = list_entry(list_next(&(now->allelem)), struct thread, allelem);
-  }
-  return NULL;
+  struct thread key;
+  struct hash_elem *e;
+
+  if (!tid_hash_ready)
+    return finding_tid == initial_thread->tid ? initial_thread : NULL;
+
+  key.tid = finding_tid;
+  lock_acquire (&tid_hash_lock);
+  e = hash_find (&tid_hash, &key.tid_elem);
+  lock_release (&tid_hash_lock);
+  return e != NULL ? hash_entry (e, struct thread, tid_elem) : NULL;
+}
+
+/* Returns a hash of thread E's tid. */
+static unsigned
+tid_hash_func (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct thread *t = hash_entry (e, struct thread, tid_elem);
+  return hash_int (t->tid);
+}
+
+/* Returns true if thread A's tid is less than thread B's. */
+static bool
+tid_less (const struct hash_elem *a, const struct hash_elem *b,
+          void *aux UNUSED)
+{
+  return (hash_entry (a, struct thread, tid_elem)->tid
+          < hash_entry (b, struct thread, tid_elem)->tid);
 }
 
 /* Offset of `stack' member within `struct thread'.
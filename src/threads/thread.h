@@ -2,8 +2,10 @@
 #define THREADS_THREAD_H
 
 #include <debug.h>
+#include <hash.h>
 #include <list.h>
 #include <stdint.h>
+#include "threads/synch.h"
 
 /* States in a thread's life cycle. */
 enum thread_status
@@ -19,6 +21,21 @@ enum thread_status
 typedef int tid_t;
 #define TID_ERROR ((tid_t) -1)          /* Error value for tid_t. */
 
+/* Buckets in run-queue delay histograms.  Bucket 0 counts delays
+   under 1 us, bucket B > 0 delays of 2**(B-1) to 2**B - 1 us, and
+   the last bucket everything longer. */
+#define SCHED_HIST_BUCKETS 24
+
+/* Thread niceness, for the 4.4BSD scheduler. */
+#define NICE_MIN -20                    /* Nicest. */
+#define NICE_DEFAULT 0                  /* Default niceness. */
+#define NICE_MAX 20                     /* Least nice. */
+
+/* Thread tickets, for the stride scheduler. */
+#define TICKETS_MIN 1                   /* Smallest share. */
+#define TICKETS_DEFAULT 100             /* Default share. */
+#define TICKETS_MAX 10000               /* Largest share. */
+
 /* Thread priorities. */
 #define PRI_MIN 0                       /* Lowest priority. */
 #define PRI_DEFAULT 31                  /* Default priority. */
@@ -76,10 +93,11 @@ typedef int tid_t;
    value, triggering the assertion. */
 /* The `elem' member has a dual purpose.  It can be an element in
    the run queue (thread.c), or it can be an element in a
-   semaphore wait list (synch.c).  It can be used these two ways
-   only because they are mutually exclusive: only a thread in the
-   ready state is on the run queue, whereas only a thread in the
-   blocked state is on a semaphore wait list. */
+   semaphore wait list (synch.c) or the sleep queue (timer.c).
+   It can be used these ways only because they are mutually
+   exclusive: only a thread in the ready state is on the run
+   queue, whereas only a thread in the blocked state is on a
+   semaphore wait list or the sleep queue. */
 struct thread
   {
     /* Owned by thread.c. */
@@ -87,38 +105,98 @@ struct thread
     enum thread_status status;          /* Thread state. */
     char name[16];                      /* Name (for debugging purposes). */
     uint8_t *stack;                     /* Saved stack pointer. */
-    int priority;                       /* Priority. */
+    int priority;                       /* Effective priority. */
+    int base_priority;                  /* Priority before donation. */
     struct list_elem allelem;           /* List element for all threads list. */
+    struct hash_elem tid_elem;          /* Element in thread table by tid. */
     /* Shared between thread.c and synch.c. */
     struct list_elem elem;              /* List element. */
-    bool once_waited;
+    struct lock *waiting_lock;          /* Lock being waited for, if any. */
+    struct list donors;                 /* Threads waiting on our locks. */
+    struct list_elem donor_elem;        /* Element in holder's donors. */
+
+    /* 4.4BSD scheduler (thread.c). */
+    int nice;                           /* Niceness, -20 to 20. */
+    int recent_cpu;                     /* Fixed-point recent CPU use. */
+
+    /* Stride scheduler (thread.c). */
+    int tickets;                        /* Share of the CPU. */
+    int64_t pass;                       /* Virtual time used so far. */
+    int heap_idx;                       /* Index in stride heap. */
+
+    /* Scheduler statistics (thread.c).  The times, from
+       timer_usecs(), and the histogram are kept only if
+       thread_sched_stats. */
+    int64_t ready_stamp;                /* When last made ready. */
+    int64_t run_stamp;                  /* When last scheduled. */
+    int64_t cpu_usecs;                  /* Total time running. */
+    unsigned voluntary_switches;        /* Blocked, exited or yielded. */
+    unsigned preempted_switches;        /* Lost the CPU while ready. */
+    unsigned *delay_hist;               /* Run-queue delays, or null. */
+
+    /* Owned by devices/timer.c. */
+    int64_t wakeup_tick;                /* Tick to wake up at. */
 
 #ifdef USERPROG
-    /* Owned by userprog/process.c. */
-    struct thread * parent;
-    int child_exit_status;
-    bool before_child_load;
-    bool die;
+    /* Owned by userprog/process.c.  In a process with several
+       threads, the members that describe the whole process, such
+       as its children, page table and statistics, are those of
+       the main thread, PROCESS. */
     int exit_status;
-    bool wait_target;
+    struct child_status *own_status;    /* Own record, shared with parent. */
+    struct list children;               /* Records of children. */
+    struct thread *process;             /* Main thread of the process. */
+    struct user_thread *user_thread;    /* Own record, unless main. */
+    struct list threads;                /* Records of the other threads. */
+    unsigned stack_slots;               /* Their stack regions in use. */
+    bool exiting;                       /* Process is being torn down. */
     uint32_t *pagedir;                  /* Page directory. */
     struct list page_table;
+    struct lock page_lock;              /* Protects page_table, loads. */
+    struct file *exec_file;             /* Executable, for lazy loading. */
     void* esp;
+
+    /* Paging statistics, kept by userprog/exception.c and vm/. */
+    unsigned minor_faults;              /* Faults served without I/O. */
+    unsigned major_faults;              /* Faults read from file or swap. */
+    unsigned evictions;                 /* Own frames taken by eviction. */
+    unsigned swap_ins;                  /* Pages read back from swap. */
+    unsigned resident_cnt;              /* Frames currently held. */
+    unsigned working_set;               /* Pages touched in last sample. */
+    unsigned resident_limit;            /* Frame cap, 0 for none. */
 #endif
 
     /* Owned by thread.c. */
     unsigned magic;                     /* Detects stack overflow. */
   };
 
+/* Timer ticks each thread may run before it is preempted.
+   Controlled by kernel command-line option "-slice=TICKS". */
+extern unsigned thread_time_slice;
+
+/* Most freed thread pages kept for reuse by thread_create(). */
+extern unsigned thread_page_cache_max;
+
 /* If false (default), use round-robin scheduler.
    If true, use multi-level feedback queue scheduler.
    Controlled by kernel command-line option "-o mlfqs". */
 extern bool thread_mlfqs;
 
+/* If true, use the stride scheduler, which shares the CPU in
+   proportion to tickets and ignores priorities.
+   Controlled by kernel command-line option "-stride". */
+extern bool thread_stride;
+
+/* If true, time run-queue delays and CPU use for
+   thread_print_stats().
+   Controlled by kernel command-line option "-schedstats". */
+extern bool thread_sched_stats;
+
 void thread_init (void);
 void thread_start (void);
 
 void thread_tick (void);
+void thread_idle_ticks (int64_t cnt);
 void thread_print_stats (void);
 
 typedef void thread_func (void *aux);
@@ -128,11 +206,16 @@ void thread_block (void);
 void thread_unblock (struct thread *);
 
 struct thread *thread_current (void);
+struct thread *tid_to_thread (tid_t);
 tid_t thread_tid (void);
 const char *thread_name (void);
 
 void thread_exit (void) NO_RETURN;
 void thread_yield (void);
+void thread_preempt (void);
+
+void thread_donate_priority (struct thread *, int priority);
+void thread_refresh_priority (struct thread *);
 
 /* Performs some operation on thread t, given auxiliary data AUX. */
 typedef void thread_action_func (struct thread *t, void *aux);
@@ -146,4 +229,7 @@ void thread_set_nice (int);
 int thread_get_recent_cpu (void);
 int thread_get_load_avg (void);
 
+int thread_get_tickets (void);
+void thread_set_tickets (int);
+
 #endif /* threads/thread.h */
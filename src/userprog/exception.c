@@ -2,9 +2,13 @@
 #include <inttypes.h>
 #include <stdio.h>
 #include "userprog/gdt.h"
+#include "userprog/process.h"
 #include "threads/interrupt.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
+#include "vm/frame.h"
 #include "vm/page.h"
+#include "vm/swap.h"
 #include "threads/vaddr.h"
 
 /* Number of page faults processed. */
@@ -12,6 +16,8 @@ static long long page_fault_cnt;
 
 static void kill (struct intr_frame *);
 static void page_fault (struct intr_frame *);
+static bool resolve_fault (void *fault_addr, void *esp, bool not_present,
+                           bool write);
 struct page* memory_map_fault (void * fault_addr);
 
 /* Registers handlers for interrupts that can be caused by user
@@ -125,7 +131,6 @@ kill (struct intr_frame *f)
 static void
 page_fault (struct intr_frame *f)
 {
-  printf("%s\n", "start page fault");
   bool not_present;  /* True: not-present page, false: writing r/o page. */
   bool write;        /* True: access was write, false: access was read. */
   bool user;         /* True: access by user, false: access by kernel. */
@@ -151,85 +156,66 @@ page_fault (struct intr_frame *f)
   not_present = (f->error_code & PF_P) == 0;
   write = (f->error_code & PF_W) != 0;
   user = (f->error_code & PF_U) != 0;
-  void* esp = thread_current() -> esp;
-
-  // if(not_present)
-  //   printf("%s\n", "not present");
-  // if(write)
-  //   printf("%s\n", "write");
-
-  if (not_present && user && in_valid_range (fault_addr))
-  {
-    printf("fault address is valid\n");
-//    if (fault_page)
-//    {
-//      printf("case 1\n");
-    struct page * fault_page = find_page (fault_addr);
-    if(!fault_page)
-    {
-      printf("%s\n", "page found");
-      return;
-    }
-//    }
-    else
-    // if (fault_addr >= f->esp - 32)
+
+  /* A fault from kernel code on a user address happens inside a
+     system call, where the user stack pointer was saved on
+     entry. */
+  void* esp = user ? f->esp : thread_current() -> esp;
+
+  /* Threads of one process fault on the same page table, so
+     look up, load and grow it under the process's page_lock. */
+  if (in_valid_range (fault_addr) && resolve_fault (fault_addr, esp,
+                                                    not_present, write))
+    return;
+
+  printf ("Page fault at %p: %s error %s page in %s context.\n",
+          fault_addr,
+          not_present ? "not present" : "rights violation",
+          write ? "writing" : "reading",
+          user ? "user" : "kernel");
+  kill (f);
+}
+
+/* Resolves a fault at user address FAULT_ADDR, with user stack
+   pointer ESP, by breaking copy-on-write, loading the page or
+   growing the stack.  Returns false if the access is invalid. */
+static bool
+resolve_fault (void *fault_addr, void *esp, bool not_present, bool write)
+{
+  struct thread *t = process_current ();
+  struct page *page;
+  bool success = false;
+
+  lock_acquire (&t -> page_lock);
+  page = find_page (fault_addr);
+  if (!not_present)
     {
-    printf("%s\n", "need grow stack");
-    if(grow_stack (fault_addr))
-      return;
+      /* A write to a page shared copy-on-write, which a sibling
+         thread may have broken already. */
+      if (write && page != NULL
+          && (page -> cow ? frame_break_cow (page) : page -> writable))
+        success = true;
     }
-  }
-  else if (not_present && !user && is_kernel_vaddr(esp))
-  {
-      printf("fault address is valid kernel\n");
-      if(load_page(find_page(fault_addr)))
-      {
-          printf("%s\n", "case 3");
-          return;
-      }
-      else if(fault_addr >= esp -32)
-      {
-          printf("%s\n", "case 4");
-          if(grow_stack (fault_addr))
-            return;
-      }
-  }
-  printf("%s\n", "go to kill");
-  /*
-  else
-  {
-    printf("fault address is Invalid\n");
-
-    struct page* page = memory_map_fault (fault_addr);
-    if (page)
+  else if (page != NULL)
     {
-        bool success = load_page(page);
-        if (success)
+      /* Major if the contents must come from disk. */
+      bool major = (page -> swap_slot != SWAP_NONE || page -> read_bytes > 0);
+      if (load_page (page))
         {
-            printf("%s\n", "load success");
-            return;
+          if (major)
+            t -> major_faults++;
+          else
+            t -> minor_faults++;
+          success = true;
         }
     }
-    else
+  else if (fault_addr >= esp - 32 && grow_stack (fault_addr))
     {
-      kill (f);
+      t -> minor_faults++;
+      success = true;
     }
-  }
-  */
-  /*
-  printf ("%s: exit(%d)\n", thread_current ()->name, -1);
-  thread_current()->exit_status = -1;
-  thread_exit();
-  */
-  /* To implement virtual memory, delete the rest of the function
-     body, and replace it with code that brings in the page to
-     which fault_addr refers. */
-  printf ("Page fault at %p: %s error %s page in %s context.\n",
-          fault_addr,
-          not_present ? "not present" : "rights violation",
-          write ? "writing" : "reading",
-          user ? "user" : "kernel");
-  kill (f);
+  lock_release (&t -> page_lock);
+  return success;
 }
 
 struct page*
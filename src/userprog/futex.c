@@ -0,0 +1,197 @@
+#include "userprog/futex.h"
+#include <debug.h>
+#include <hash.h>
+#include <list.h>
+#include <stdint.h>
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "userprog/process.h"
+#include "vm/page.h"
+
+/* Futexes.
+
+   A thread waiting on a user word sleeps on a semaphore of its
+   own, listed in one bucket of a small hash table under the
+   word's key.  The key is the page directory and user address,
+   or for a word in shared memory (see vm/shm.c), whose frame is
+   mapped at different addresses in each process, the frame's
+   kernel address.
+
+   The word is compared with the expected value under the
+   bucket's lock, and waking takes the same lock, so a wake that
+   follows a change to the word cannot slip in between the
+   comparison and the waiter's entering the bucket.  One that
+   comes after that but before sema_down() is remembered by the
+   semaphore.  A process that is exiting wakes all its waiters
+   the same way (see process.c). */
+struct futex_key
+  {
+    uint32_t *pagedir;          /* Page directory, or NULL if shared. */
+    const void *addr;           /* User address, or frame address. */
+  };
+
+/* A thread in futex_wait(). */
+struct futex_waiter
+  {
+    struct list_elem elem;      /* Element in bucket's WAITERS. */
+    struct futex_key key;       /* Word waited on. */
+    struct thread *process;     /* Main thread of waiter's process. */
+    struct semaphore sema;      /* Upped by futex_wake(). */
+  };
+
+struct futex_bucket
+  {
+    struct lock lock;           /* Protects WAITERS. */
+    struct list waiters;        /* Waiters, oldest first. */
+  };
+
+/* Number of hash buckets. */
+#define FUTEX_BUCKETS 64
+
+static struct futex_bucket buckets[FUTEX_BUCKETS];
+
+static bool make_key (int *addr, struct futex_key *);
+static struct futex_bucket *find_bucket (const struct futex_key *);
+
+/* Initializes the hash table. */
+void
+futex_init (void)
+{
+  size_t i;
+
+  for (i = 0; i < FUTEX_BUCKETS; i++)
+    {
+      lock_init (&buckets[i].lock);
+      list_init (&buckets[i].waiters);
+    }
+}
+
+/* Blocks until futex_wake() on ADDR if the word there holds
+   EXPECTED, and returns 0 once woken.  Returns -1 at once if the
+   word holds something else, ADDR is not aligned, or the process
+   is exiting. */
+int
+futex_wait (int *addr, int expected)
+{
+  struct futex_waiter w;
+  struct futex_bucket *b;
+
+  if (!make_key (addr, &w.key))
+    return -1;
+  b = find_bucket (&w.key);
+  w.process = thread_current ()->process;
+  lock_acquire (&b->lock);
+  if (*addr != expected || w.process->exiting)
+    {
+      lock_release (&b->lock);
+      unpin_user_buffer (addr, sizeof *addr);
+      return -1;
+    }
+  sema_init (&w.sema, 0);
+  list_push_back (&b->waiters, &w.elem);
+  lock_release (&b->lock);
+  unpin_user_buffer (addr, sizeof *addr);
+
+  sema_down (&w.sema);
+  return 0;
+}
+
+/* Wakes up to CNT threads waiting on ADDR, oldest first, and
+   returns how many were woken. */
+int
+futex_wake (int *addr, int cnt)
+{
+  struct futex_key key;
+  struct futex_bucket *b;
+  struct list_elem *e, *next;
+  int woken = 0;
+
+  if (!make_key (addr, &key))
+    return 0;
+  unpin_user_buffer (addr, sizeof *addr);
+  b = find_bucket (&key);
+  lock_acquire (&b->lock);
+  for (e = list_begin (&b->waiters);
+       e != list_end (&b->waiters) && woken < cnt; e = next)
+    {
+      struct futex_waiter *w = list_entry (e, struct futex_waiter, elem);
+      next = list_next (e);
+      if (w->key.pagedir == key.pagedir && w->key.addr == key.addr)
+        {
+          list_remove (&w->elem);
+          sema_up (&w->sema);
+          woken++;
+        }
+    }
+  lock_release (&b->lock);
+  return woken;
+}
+
+/* Wakes every thread of PROCESS that is in futex_wait(), which
+   must already be marked as exiting. */
+void
+futex_cancel (struct thread *process)
+{
+  size_t i;
+
+  ASSERT (process->exiting);
+  for (i = 0; i < FUTEX_BUCKETS; i++)
+    {
+      struct futex_bucket *b = &buckets[i];
+      struct list_elem *e, *next;
+
+      lock_acquire (&b->lock);
+      for (e = list_begin (&b->waiters); e != list_end (&b->waiters);
+           e = next)
+        {
+          struct futex_waiter *w = list_entry (e, struct futex_waiter,
+                                               elem);
+          next = list_next (e);
+          if (w->process == process)
+            {
+              list_remove (&w->elem);
+              sema_up (&w->sema);
+            }
+        }
+      lock_release (&b->lock);
+    }
+}
+
+/* Pins the current process's word at ADDR, which the caller
+   must unpin, and stores its key into *KEY.  Returns false, with
+   nothing pinned, if ADDR is not word-aligned or not in a
+   page. */
+static bool
+make_key (int *addr, struct futex_key *key)
+{
+  struct lock *page_lock = &process_current ()->page_lock;
+  uint32_t *pd = thread_current ()->pagedir;
+  struct page *page;
+
+  if ((uintptr_t) addr % sizeof *addr != 0
+      || !pin_user_buffer (addr, sizeof *addr, false))
+    return false;
+  lock_acquire (page_lock);
+  page = find_page (addr);
+  lock_release (page_lock);
+  if (page != NULL && page->shared)
+    {
+      key->pagedir = NULL;
+      key->addr = pagedir_get_page (pd, addr);
+    }
+  else
+    {
+      key->pagedir = pd;
+      key->addr = addr;
+    }
+  return true;
+}
+
+/* Returns the bucket for KEY. */
+static struct futex_bucket *
+find_bucket (const struct futex_key *key)
+{
+  return &buckets[hash_bytes (key, sizeof *key) % FUTEX_BUCKETS];
+}
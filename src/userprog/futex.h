@@ -0,0 +1,15 @@
+#ifndef USERPROG_FUTEX_H
+#define USERPROG_FUTEX_H
+
+#include <stdbool.h>
+
+struct thread;
+
+/* Blocking on a word of user memory, for user-level locks that
+   only enter the kernel when contended. */
+void futex_init (void);
+int futex_wait (int *addr, int expected);
+int futex_wake (int *addr, int cnt);
+void futex_cancel (struct thread *process);
+
+#endif /* userprog/futex.h */
@@ -22,8 +22,10 @@ pagedir_create (void)
   return pd;
 }
 
-/* Destroys page directory PD, freeing all the pages it
-   references. */
+/* Destroys page directory PD and its page tables.  The pages
+   it maps belong to the frame table (see vm/frame.c), which must
+   have released them already, so the page tables themselves are
+   not scanned. */
 void
 pagedir_destroy (uint32_t *pd)
 {
@@ -35,15 +37,7 @@ pagedir_destroy (uint32_t *pd)
   ASSERT (pd != init_page_dir);
   for (pde = pd; pde < pd + pd_no (PHYS_BASE); pde++)
     if (*pde & PTE_P)
-      {
-        uint32_t *pt = pde_get_pt (*pde);
-        uint32_t *pte;
-
-        for (pte = pt; pte < pt + PGSIZE / sizeof *pte; pte++)
-          if (*pte & PTE_P)
-            palloc_free_page (pte_get_page (*pte));
-        palloc_free_page (pt);
-      }
+      palloc_free_page (pde_get_pt (*pde));
   palloc_free_page (pd);
 }
 
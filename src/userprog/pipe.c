@@ -0,0 +1,328 @@
+#include "userprog/pipe.h"
+#include <debug.h>
+#include <list.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+#include "userprog/process.h"
+#include "vm/frame.h"
+#include "vm/page.h"
+
+/* A pipe.
+
+   This is the circular buffer of devices/intq.c grown to a page
+   and used only between kernel threads, so that a lock and
+   condition variables take the place of disabling interrupts.
+   Readers and writers move as many bytes as they can with each
+   memcpy() instead of one at a time.
+
+   Whole, page-aligned pages of a writer's buffer are not copied
+   at all.  Their frames are lent to the pipe copy-on-write (see
+   vm/frame.c), and a reader whose buffer is also page-aligned
+   has the frame mapped in place of its own page.  To keep the
+   stream in order, the buffer and the loans are never both in
+   use: a writer of bytes waits for the loans to drain, and a
+   lender for the buffer to empty.
+
+   A user thread whose process starts exiting stops waiting on a
+   pipe, and its read or write fails; pipe_cancel() wakes it. */
+struct pipe
+  {
+    struct list_elem elem;      /* Element in pipe_list. */
+    struct lock lock;           /* Protects all the members below. */
+    struct condition not_empty; /* Signaled when data arrives. */
+    struct condition not_full;  /* Signaled when space appears. */
+
+    uint8_t *buf;               /* PIPE_BUFSIZE bytes. */
+    size_t head;                /* Bytes ever written. */
+    size_t tail;                /* Bytes ever read. */
+
+    struct list loans;          /* Lent frames, oldest first. */
+    size_t loan_cnt;            /* Number of elements in LOANS. */
+    size_t loan_ofs;            /* Bytes of the oldest already read. */
+
+    int readers;                /* Descriptors on the read end. */
+    int writers;                /* Descriptors on the write end. */
+  };
+
+/* A frame lent to a pipe. */
+struct loan
+  {
+    struct list_elem elem;      /* Element in pipe's LOANS. */
+    void *kpage;                /* The frame. */
+  };
+
+/* Pipe buffer size, in bytes. */
+#define PIPE_BUFSIZE PGSIZE
+
+/* Most frames one pipe holds on loan. */
+#define PIPE_LOANS_MAX 16
+
+/* All pipes, for pipe_cancel(). */
+static struct list pipe_list;
+static struct lock pipe_list_lock;
+
+static bool lend (struct pipe *, const void *upage);
+static void end_loan (struct pipe *, bool flipped);
+
+/* Initializes the pipe list. */
+void
+pipe_init (void)
+{
+  list_init (&pipe_list);
+  lock_init (&pipe_list_lock);
+}
+
+/* Creates a pipe with one descriptor on each end, or returns a
+   null pointer if memory is short. */
+struct pipe *
+pipe_create (void)
+{
+  struct pipe *p = malloc (sizeof *p);
+  if (p == NULL)
+    return NULL;
+  p->buf = palloc_get_page (0);
+  if (p->buf == NULL)
+    {
+      free (p);
+      return NULL;
+    }
+  lock_init (&p->lock);
+  cond_init (&p->not_empty);
+  cond_init (&p->not_full);
+  p->head = p->tail = 0;
+  list_init (&p->loans);
+  p->loan_cnt = p->loan_ofs = 0;
+  p->readers = p->writers = 1;
+  lock_acquire (&pipe_list_lock);
+  list_push_back (&pipe_list, &p->elem);
+  lock_release (&pipe_list_lock);
+  return p;
+}
+
+/* Adds a descriptor on the write end of P if WRITER is true, on
+   the read end otherwise, and returns P. */
+struct pipe *
+pipe_reopen (struct pipe *p, bool writer)
+{
+  lock_acquire (&p->lock);
+  if (writer)
+    p->writers++;
+  else
+    p->readers++;
+  lock_release (&p->lock);
+  return p;
+}
+
+/* Drops a descriptor from the write end of P if WRITER is true,
+   from the read end otherwise.  Once the last writer goes,
+   readers see end of file; once the last reader goes, writes
+   fail.  Frees P after its last descriptor. */
+void
+pipe_close (struct pipe *p, bool writer)
+{
+  bool last;
+
+  lock_acquire (&p->lock);
+  if (writer)
+    {
+      ASSERT (p->writers > 0);
+      if (--p->writers == 0)
+        cond_broadcast (&p->not_empty, &p->lock);
+    }
+  else
+    {
+      ASSERT (p->readers > 0);
+      if (--p->readers == 0)
+        cond_broadcast (&p->not_full, &p->lock);
+    }
+  last = p->readers == 0 && p->writers == 0;
+  lock_release (&p->lock);
+  if (last)
+    {
+      lock_acquire (&pipe_list_lock);
+      list_remove (&p->elem);
+      lock_release (&pipe_list_lock);
+      while (!list_empty (&p->loans))
+        end_loan (p, false);
+      palloc_free_page (p->buf);
+      free (p);
+    }
+}
+
+/* Reads up to SIZE bytes from P into BUFFER.  If BLOCK, sleeps
+   until at least one byte is available.  Returns the number of
+   bytes read, which is 0 only at end of file or if P is empty
+   and not BLOCK, or -1 if the caller's process starts exiting.
+   A user BUFFER must be pinned. */
+int
+pipe_read (struct pipe *p, void *buffer_, size_t size, bool block)
+{
+  uint8_t *buffer = buffer_;
+  size_t done = 0;
+
+  lock_acquire (&p->lock);
+  while (p->head == p->tail && list_empty (&p->loans) && p->writers > 0
+         && size > 0 && block && !process_exiting ())
+    cond_wait (&p->not_empty, &p->lock);
+  if (process_exiting ())
+    {
+      lock_release (&p->lock);
+      return -1;
+    }
+  while (done < size)
+    {
+      uint8_t *dst = buffer + done;
+      size_t chunk;
+
+      if (p->head != p->tail)
+        {
+          size_t ofs = p->tail % PIPE_BUFSIZE;
+          chunk = p->head - p->tail;
+          if (chunk > PIPE_BUFSIZE - ofs)
+            chunk = PIPE_BUFSIZE - ofs;
+          if (chunk > size - done)
+            chunk = size - done;
+          memcpy (dst, p->buf + ofs, chunk);
+          p->tail += chunk;
+        }
+      else if (!list_empty (&p->loans))
+        {
+          struct loan *l = list_entry (list_front (&p->loans),
+                                       struct loan, elem);
+          if (p->loan_ofs == 0 && pg_ofs (dst) == 0
+              && size - done >= PGSIZE && is_user_vaddr (dst)
+              && page_flip (dst, l->kpage))
+            {
+              chunk = PGSIZE;
+              end_loan (p, true);
+            }
+          else
+            {
+              chunk = PGSIZE - p->loan_ofs;
+              if (chunk > size - done)
+                chunk = size - done;
+              memcpy (dst, (uint8_t *) l->kpage + p->loan_ofs, chunk);
+              p->loan_ofs += chunk;
+              if (p->loan_ofs == PGSIZE)
+                end_loan (p, false);
+            }
+        }
+      else
+        break;
+      done += chunk;
+    }
+  if (done > 0)
+    cond_broadcast (&p->not_full, &p->lock);
+  lock_release (&p->lock);
+  return done;
+}
+
+/* Writes the SIZE bytes at BUFFER to P, sleeping whenever P is
+   full.  Returns SIZE, or -1 if the read end is closed, or the
+   caller's process starts exiting, before everything could be
+   written.  A user BUFFER must be pinned;
+   its whole pages are lent rather than copied. */
+int
+pipe_write (struct pipe *p, const void *buffer_, size_t size)
+{
+  const uint8_t *buffer = buffer_;
+  bool may_lend = is_user_vaddr (buffer);
+  size_t done = 0;
+
+  lock_acquire (&p->lock);
+  while (done < size && p->readers > 0 && !process_exiting ())
+    {
+      const uint8_t *src = buffer + done;
+      size_t ofs, chunk;
+
+      if (may_lend && pg_ofs (src) == 0 && size - done >= PGSIZE)
+        {
+          if (p->head != p->tail || p->loan_cnt >= PIPE_LOANS_MAX)
+            cond_wait (&p->not_full, &p->lock);
+          else if (lend (p, src))
+            {
+              done += PGSIZE;
+              cond_broadcast (&p->not_empty, &p->lock);
+            }
+          else
+            may_lend = false;
+          continue;
+        }
+
+      ofs = p->head % PIPE_BUFSIZE;
+      chunk = PIPE_BUFSIZE - (p->head - p->tail);
+      if (chunk == 0 || !list_empty (&p->loans))
+        {
+          cond_wait (&p->not_full, &p->lock);
+          continue;
+        }
+      if (chunk > PIPE_BUFSIZE - ofs)
+        chunk = PIPE_BUFSIZE - ofs;
+      if (chunk > size - done)
+        chunk = size - done;
+      memcpy (p->buf + ofs, src, chunk);
+      p->head += chunk;
+      done += chunk;
+      cond_broadcast (&p->not_empty, &p->lock);
+    }
+  lock_release (&p->lock);
+  return done == size ? (int) size : -1;
+}
+
+/* Wakes every thread waiting on a pipe, so that those whose
+   process is exiting give up. */
+void
+pipe_cancel (void)
+{
+  struct list_elem *e;
+
+  lock_acquire (&pipe_list_lock);
+  for (e = list_begin (&pipe_list); e != list_end (&pipe_list);
+       e = list_next (e))
+    {
+      struct pipe *p = list_entry (e, struct pipe, elem);
+      lock_acquire (&p->lock);
+      cond_broadcast (&p->not_empty, &p->lock);
+      cond_broadcast (&p->not_full, &p->lock);
+      lock_release (&p->lock);
+    }
+  lock_release (&pipe_list_lock);
+}
+
+/* Appends the frame of the writer's page UPAGE to P's loans.
+   Returns false if it cannot be lent.  Caller must hold P's
+   lock. */
+static bool
+lend (struct pipe *p, const void *upage)
+{
+  struct loan *l = malloc (sizeof *l);
+  if (l == NULL)
+    return false;
+  l->kpage = page_lend (upage);
+  if (l->kpage == NULL)
+    {
+      free (l);
+      return false;
+    }
+  list_push_back (&p->loans, &l->elem);
+  p->loan_cnt++;
+  return true;
+}
+
+/* Retires P's oldest loan, returning its frame unless FLIPPED,
+   in which case a reader has taken it over.  Caller must hold
+   P's lock, or be the last user of P. */
+static void
+end_loan (struct pipe *p, bool flipped)
+{
+  struct loan *l = list_entry (list_pop_front (&p->loans),
+                               struct loan, elem);
+  if (!flipped)
+    frame_return (l->kpage);
+  free (l);
+  p->loan_cnt--;
+  p->loan_ofs = 0;
+}
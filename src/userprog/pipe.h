@@ -0,0 +1,19 @@
+#ifndef USERPROG_PIPE_H
+#define USERPROG_PIPE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* A one-way byte stream between processes, kept in a page-sized
+   ring buffer.  Each end counts the descriptors open on it. */
+struct pipe;
+
+void pipe_init (void);
+struct pipe *pipe_create (void);
+struct pipe *pipe_reopen (struct pipe *, bool writer);
+void pipe_close (struct pipe *, bool writer);
+int pipe_read (struct pipe *, void *, size_t size, bool block);
+int pipe_write (struct pipe *, const void *, size_t size);
+void pipe_cancel (void);
+
+#endif /* userprog/pipe.h */
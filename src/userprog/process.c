@@ -1,32 +1,161 @@
 #include "userprog/process.h"
 #include <debug.h>
+#include <hash.h>
 #include <inttypes.h>
 #include <round.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "userprog/futex.h"
 #include "userprog/gdt.h"
+#include "devices/timer.h"
 #include "userprog/pagedir.h"
+#include "userprog/pipe.h"
+#include "userprog/syscall.h"
 #include "userprog/tss.h"
 #include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
+#include "filesys/inode.h"
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
 #include "threads/palloc.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "threads/malloc.h"
 #include "vm/frame.h"
 #include "vm/page.h"
+#include "vm/shm.h"
+#include "vm/swap.h"
 
 #define WORD_SIZE 4
-#define MAX_ARGV_NUM 1024
+
+/* Most stack pages the arguments of a new process may take, and
+   so a bound on the length of a command line. */
+#define ARGS_MAX_PAGES 8
+
+/* What a parent and child know about each other.  Shared by the
+   two, so that the child's exit status outlives its struct
+   thread, and freed when both are done with it. */
+struct child_status
+  {
+    tid_t tid;                  /* Child's tid. */
+    tid_t parent_tid;           /* Parent's tid. */
+    struct hash_elem elem;      /* Element in child_table. */
+    struct list_elem list_elem; /* Element in parent's children. */
+    struct semaphore loaded;    /* Up once the child has loaded. */
+    bool load_success;          /* Did it succeed? */
+    bool exited;                /* Has the child exited? */
+    int exit_status;            /* Valid once EXITED. */
+    int ref_cnt;                /* Parent and/or child, 0 to 2. */
+  };
+
+/* Records of live parents' children, by child tid, so that
+   process_wait() finds its child in O(1).  Protects the
+   exited, ref_cnt and children members above. */
+static struct hash child_table;
+static struct lock child_lock;
+
+/* Broadcast under child_lock when a child exits, or a process
+   starts exiting, so that its threads stop waiting. */
+static struct condition child_exited;
+
+/* Teardown statistics, also protected by child_lock. */
+static long long reap_cnt;      /* Processes torn down. */
+static long long reap_pages;    /* Pages they released. */
+static long long reap_usecs;    /* Time spent tearing them down. */
+
+static hash_hash_func child_hash;
+static hash_less_func child_less;
+static void release_status (struct child_status *);
+
+/* Arguments handed from process_execute() to start_process(). */
+struct process_start
+  {
+    char *cmdline;              /* Copy of the command line. */
+    struct child_status *status; /* Shared record. */
+    unsigned resident_limit;    /* Inherited frame cap. */
+    struct thread *parent;      /* Thread starting the process. */
+    const struct spawn_action *actions; /* Files to give the child. */
+    int action_cnt;             /* Number of elements in ACTIONS. */
+  };
+
+/* Threads of a user process.
+
+   Besides its main thread, a process may run up to THREADS_MAX
+   more, which share its page directory and use the main thread's
+   page table, files and children (see thread.h).  Each gets a
+   THREAD_STACK_SIZE region for its user stack below the STACK_MAX
+   reserved for the main thread's; nothing stops a stack growing
+   into the region below it.
+
+   The process is torn down by its main thread, once all the
+   others are gone.  exit() in any thread, or a thread dying of an
+   exception, marks the process as exiting, and then every thread
+   ends on its next return to user mode, whether from a system
+   call or from preemption.  Threads sleeping in futex_wait(), a
+   pipe, wait() or thread_join() are woken for this, and their
+   calls fail. */
+#define STACK_MAX (8 * 1024 * 1024)
+#define THREAD_STACK_SIZE (256 * 1024)
+#define THREADS_MAX 16
+
+/* What a process knows about one of its threads other than the
+   main one.  Freed by whoever joins the thread. */
+struct user_thread
+  {
+    tid_t tid;                  /* The thread's tid. */
+    struct list_elem elem;      /* Element in process's threads. */
+    int slot;                   /* Stack region in use. */
+    bool joining;               /* In process_thread_join()? */
+    bool exited;                /* Has the thread exited? */
+  };
+
+/* Protects every process's threads, stack_slots and exiting
+   members, and the records in THREADS. */
+static struct lock threads_lock;
+
+/* Broadcast under threads_lock when a thread exits or its record
+   is released, or a process starts exiting. */
+static struct condition threads_changed;
+
+/* Arguments handed from process_thread_spawn() to
+   start_thread(). */
+struct thread_start
+  {
+    struct thread *process;     /* Main thread of the process. */
+    struct user_thread *record; /* The new thread's record. */
+    void (*eip) (void);         /* User code to start at. */
+    void *fn;                   /* Arguments for EIP. */
+    void *aux;
+    struct semaphore started;   /* Up once the thread has started. */
+    bool success;               /* Did it? */
+  };
+
+static thread_func start_thread NO_RETURN;
+static void wait_threads (struct thread *process);
+static void end_thread (struct thread *);
 
 static thread_func start_process NO_RETURN;
+static size_t first_word (const char *cmdline, char *word, size_t size);
+static bool push_args (const char *cmdline, void **esp);
+static bool extend_stack (uint8_t **low, const void *addr);
 static bool load (const char *cmdline, void (**eip) (void), void **esp);
 
+/* Sets up the table of child records. */
+void
+process_init (void)
+{
+  lock_init (&child_lock);
+  cond_init (&child_exited);
+  lock_init (&threads_lock);
+  cond_init (&threads_changed);
+  if (!hash_init (&child_table, child_hash, child_less, NULL))
+    PANIC ("cannot allocate child table");
+}
+
 /* Starts a new thread running a user program loaded from
    FILENAME.  The new thread may be scheduled (and may even exit)
    before process_execute() returns.  Returns the new process's
@@ -34,35 +163,77 @@ static bool load (const char *cmdline, void (**eip) (void), void **esp);
 tid_t
 process_execute (const char *file_name)
 {
-  char *fn_copy;
+  return process_spawn (file_name, NULL, 0);
+}
+
+/* Like process_execute(), but the new process first opens files
+   as the ACTION_CNT elements of ACTIONS say, in terms of the
+   caller's files.  The process fails to start, and TID_ERROR is
+   returned, if any action fails. */
+tid_t
+process_spawn (const char *file_name, const struct spawn_action *actions,
+               int action_cnt)
+{
+  char *cmdline;
+  char name[16];
+  size_t len;
   tid_t tid;
+  struct process_start start;
+  struct child_status *status;
 
   /* Make a copy of FILE_NAME.
      Otherwise there's a race between the caller and load(). */
-  fn_copy = palloc_get_page (0);
-  // fn_copy = number_to_frame(get_free_frame_number(PAL_USER));
-  if (fn_copy == NULL)
+  len = strlen (file_name);
+  if (len >= ARGS_MAX_PAGES * PGSIZE)
     return TID_ERROR;
-  strlcpy (fn_copy, file_name, PGSIZE);
-
-  /* Create a new thread to execute FILE_NAME. */
-  char *save_ptr;
-  file_name = strtok_r (file_name, " ", &save_ptr);
+  cmdline = malloc (len + 1);
+  if (cmdline == NULL)
+    return TID_ERROR;
+  memcpy (cmdline, file_name, len + 1);
 
-  tid = thread_create (file_name, PRI_DEFAULT, start_process, fn_copy);
-  struct thread *child = tid_to_thread (tid);
-  child -> parent = thread_current();
-  child -> parent -> before_child_load = true;
+  status = malloc (sizeof *status);
+  if (status == NULL)
+  {
+    free (cmdline);
+    return TID_ERROR;
+  }
+  status -> parent_tid = process_current () -> tid;
+  sema_init (&status -> loaded, 0);
+  status -> exited = false;
+  status -> load_success = false;
+  status -> exit_status = -1;
+  status -> ref_cnt = 2;
+
+  start.cmdline = cmdline;
+  start.status = status;
+  start.resident_limit = process_current () -> resident_limit;
+  start.parent = process_current ();
+  start.actions = actions;
+  start.action_cnt = action_cnt;
 
-  // wait until child thread call load function
-  while (thread_current()->before_child_load)
+  /* Create a new thread to execute FILE_NAME. */
+  first_word (cmdline, name, sizeof name);
+  tid = thread_create (name, PRI_DEFAULT, start_process, &start);
+  if (tid == TID_ERROR)
   {
-    thread_yield ();
+    free (cmdline);
+    free (status);
+    return TID_ERROR;
   }
+  status -> tid = tid;
+  lock_acquire (&child_lock);
+  hash_insert (&child_table, &status -> elem);
+  list_push_back (&process_current () -> children, &status -> list_elem);
+  lock_release (&child_lock);
+
+  // wait until child thread call load function
+  // (START lives on our stack, so we must not return before)
+  sema_down (&status -> loaded);
 
   // if child thread fail to load, return -1
-  if (thread_current()->child_exit_status == TID_ERROR)
+  if (!status -> load_success)
   {
+    process_wait (tid);
     return TID_ERROR;
   }
 
@@ -72,105 +243,141 @@ process_execute (const char *file_name)
 /* A thread function that loads a user process and starts it
    running. */
 static void
-start_process (void *file_name_)
+start_process (void *start_)
 {
-    printf("%s %d\n", "start process", thread_current ()->tid);
-  char *file_name = file_name_;
+  struct process_start *start = start_;
+  struct child_status *status = start -> status;
+  char *cmdline = start -> cmdline;
+  char file_name[NAME_MAX + 1];
   struct intr_frame if_;
   bool success;
 
-  // Get actual file name (first parsed token)
-  char *save_ptr;
-  file_name = strtok_r(file_name, " ", &save_ptr);
+  thread_current () -> own_status = status;
+  thread_current () -> resident_limit = start -> resident_limit;
+  thread_current () -> exit_status = -1;  // unless it calls exit()
 
   // Initialize page table
   init_page_table(&thread_current() -> page_table);
+  lock_init (&thread_current () -> page_lock);
 
   /* Initialize interrupt frame and load executable. */
   memset (&if_, 0, sizeof if_);
   if_.gs = if_.fs = if_.es = if_.ds = if_.ss = SEL_UDSEG;
   if_.cs = SEL_UCSEG;
   if_.eflags = FLAG_IF | FLAG_MBS;
-  success = load (file_name, &if_.eip, &if_.esp);
-  printf("%s %d\n", "after the load function", thread_current()->tid);
+  success = (apply_spawn_actions (thread_current (), start -> parent,
+                                  start -> actions, start -> action_cnt)
+             && first_word (cmdline, file_name, sizeof file_name)
+                < sizeof file_name
+             && load (file_name, &if_.eip, &if_.esp)
+             && push_args (cmdline, &if_.esp));
+  free (cmdline);
+
+  /* Tell the parent how it went; START is not valid after. */
+  status -> load_success = success;
+  sema_up (&status -> loaded);
 
   /* If load failed, quit. */
   if (!success)
   {
-      printf("%s\n", "load failed");
     thread_current() -> exit_status = TID_ERROR;
-    thread_current()->parent->child_exit_status = TID_ERROR;
-    thread_current()->parent->before_child_load = false;
-    // palloc_free_page (file_name);
-    free_frame (file_name);
     thread_exit ();
   }
 
-  thread_current()->parent->before_child_load = false;
+  /* Start the user process by simulating a return from an
+     interrupt, implemented by intr_exit (in
+     threads/intr-stubs.S).  Because intr_exit takes all of its
+     arguments on the stack in the form of a `struct intr_frame',
+     we just point the stack pointer (%esp) to our stack frame
+     and jump to it. */
+  asm volatile ("movl %0, %%esp; jmp intr_exit" : : "g" (&if_) : "memory");
+  NOT_REACHED ();
+}
 
-  if (if_.esp != PHYS_BASE)
-  {
-    // printf("%s\n", "not PHYS BASE");
-    thread_exit();
-    return;
-  }
+/* Copies the first word of CMDLINE into the SIZE bytes at WORD,
+   truncating it if necessary, and returns its full length. */
+static size_t
+first_word (const char *cmdline, char *word, size_t size)
+{
+  size_t len;
+
+  while (*cmdline == ' ')
+    cmdline++;
+  for (len = 0; cmdline[len] != ' ' && cmdline[len] != '\0'; len++)
+    if (len + 1 < size)
+      word[len] = cmdline[len];
+  word[len + 1 < size ? len : size - 1] = '\0';
+  return len;
+}
 
-  char *token;
-  char **argvs = malloc(MAX_ARGV_NUM * sizeof(char *));
-  if (!argvs)
-  {
-    free(argvs);
-    return false;
-  }
-  int i, argc = 0;
+/* Lays out the words of CMDLINE on the user stack below *ESP as
+   the arguments of main(), and points *ESP at the fake return
+   address below them.  Each word is copied into the string area
+   at the top of the stack as it is found, and its address stored
+   in argv[], which grows down beneath the strings and is put in
+   order at the end, so CMDLINE is scanned only once.  Further
+   stack pages are mapped as the arguments reach them.  Returns
+   false if they do not fit in ARGS_MAX_PAGES pages. */
+static bool
+push_args (const char *cmdline, void **esp)
+{
+  uint8_t *low = pg_round_down ((uint8_t *) *esp - 1);
+  char *str = (char *) *esp - (strlen (cmdline) + 1);
+  char **argv = (char **) ((uintptr_t) str & ~(WORD_SIZE - 1));
+  uint32_t *sp;
+  int argc = 0;
+  int i;
 
-  // Push args onto stack
-  for (token = file_name; token != NULL; token = strtok_r (NULL, " ", &save_ptr))
+  if (!extend_stack (&low, argv - 1))
+    return false;
+  *--argv = NULL;
+  while (*cmdline != '\0')
   {
-    // printf("%s %d\n", token, argc);
-    if_.esp -= strlen(token) + 1;
-    argvs[argc] = if_.esp;
+    if (*cmdline == ' ')
+    {
+      cmdline++;
+      continue;
+    }
+    if (!extend_stack (&low, argv - 1))
+      return false;
+    *--argv = str;
+    while (*cmdline != ' ' && *cmdline != '\0')
+      *str++ = *cmdline++;
+    *str++ = '\0';
     argc++;
-    memcpy(if_.esp, token, strlen(token) + 1);
-    // printf("%s\n", "after memcpy");
   }
-  argvs[argc] = 0;
 
-  // Align to word size (4 bytes)
-  i = (size_t) if_.esp % WORD_SIZE;
-  if (i)
+  /* argv[] was filled from its end. */
+  for (i = 0; i < argc / 2; i++)
   {
-    if_.esp -= i;
-    memcpy(if_.esp, &argvs[argc], i);
+    char *tmp = argv[i];
+    argv[i] = argv[argc - 1 - i];
+    argv[argc - 1 - i] = tmp;
   }
-  // Push argv[i] for all i
-  for (i = argc; i >= 0; i--)
+
+  sp = (uint32_t *) argv;
+  if (!extend_stack (&low, sp - 3))
+    return false;
+  *--sp = (uint32_t) argv;
+  *--sp = argc;
+  *--sp = 0;                    /* Fake return address. */
+  *esp = sp;
+  return true;
+}
+
+/* Maps user stack pages below *LOW, which is the lowest one
+   mapped so far, until ADDR is mapped too. */
+static bool
+extend_stack (uint8_t **low, const void *addr)
+{
+  while ((const uint8_t *) addr < *low)
   {
-    if_.esp -= sizeof(char *);
-    memcpy(if_.esp, &argvs[i], sizeof(char *));
+    if (*low <= (uint8_t *) PHYS_BASE - ARGS_MAX_PAGES * PGSIZE
+        || !grow_stack (*low - PGSIZE))
+      return false;
+    *low -= PGSIZE;
   }
-  // Push argv
-  token = if_.esp;
-  if_.esp -= sizeof(char **);
-  memcpy(if_.esp, &token, sizeof(char **));
-  // Push argc
-  if_.esp -= sizeof(int);
-  memcpy(if_.esp, &argc, sizeof(int));
-  // Push fake return addr
-  if_.esp -= sizeof(void *);
-  memcpy(if_.esp, &argvs[argc], sizeof(void *));
-  // Free argv
-  free(argvs);
-
-printf("%s\n", "after the argument parsing");
-  /* Start the user process by simulating a return from an
-     interrupt, implemented by intr_exit (in
-     threads/intr-stubs.S).  Because intr_exit takes all of its
-     arguments on the stack in the form of a `struct intr_frame',
-     we just point the stack pointer (%esp) to our stack frame
-     and jump to it. */
-  asm volatile ("movl %0, %%esp; jmp intr_exit" : : "g" (&if_) : "memory");
-  NOT_REACHED ();
+  return true;
 }
 
 /* Waits for thread TID to die and returns its exit status.  If
@@ -180,23 +387,349 @@ printf("%s\n", "after the argument parsing");
    been successfully called for the given TID, returns -1
    immediately, without waiting.
 
-   This function will be implemented in problem 2-2.  For now, it
-   does nothing. */
+   The child's record is found through child_table and is
+   removed once waited for, so a second wait fails.  Returns -1
+   as well if the calling process starts exiting first. */
 int
-process_wait (tid_t child_tid UNUSED)
+process_wait (tid_t child_tid)
+{
+  struct thread *proc = process_current ();
+  struct child_status key;
+  struct child_status *status = NULL;
+  struct hash_elem *e;
+  int exit_status;
+
+  key.tid = child_tid;
+  lock_acquire (&child_lock);
+  e = hash_find (&child_table, &key.elem);
+  if (e != NULL)
+  {
+    status = hash_entry (e, struct child_status, elem);
+    if (status -> parent_tid == proc -> tid)
+    {
+      hash_delete (&child_table, &status -> elem);
+      list_remove (&status -> list_elem);
+    }
+    else
+      status = NULL;
+  }
+  if (status == NULL)
+  {
+    lock_release (&child_lock);
+    return -1;
+  }
+
+  while (!status -> exited && !proc -> exiting)
+    cond_wait (&child_exited, &child_lock);
+  exit_status = status -> exited ? status -> exit_status : -1;
+  lock_release (&child_lock);
+  release_status (status);
+  return exit_status;
+}
+
+/* Drops one reference to STATUS, freeing it after the last. */
+static void
+release_status (struct child_status *status)
+{
+  bool last;
+
+  lock_acquire (&child_lock);
+  last = --status -> ref_cnt == 0;
+  lock_release (&child_lock);
+  if (last)
+    free (status);
+}
+
+/* Returns a hash of child record E's tid. */
+static unsigned
+child_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  return hash_int (hash_entry (e, struct child_status, elem) -> tid);
+}
+
+/* Returns true if child record A's tid is less than B's. */
+static bool
+child_less (const struct hash_elem *a, const struct hash_elem *b,
+            void *aux UNUSED)
+{
+  return (hash_entry (a, struct child_status, elem) -> tid
+          < hash_entry (b, struct child_status, elem) -> tid);
+}
+
+/* Returns the main thread of the current process. */
+struct thread *
+process_current (void)
+{
+  return thread_current () -> process;
+}
+
+/* Starts a new thread in the current process, running user code
+   at EIP with FN and AUX as its arguments on a fresh stack.
+   Returns the new thread's tid, or TID_ERROR if it cannot be
+   started. */
+tid_t
+process_thread_spawn (void (*eip) (void), void *fn, void *aux)
 {
-  struct thread* child = tid_to_thread(child_tid);
-  if (!child || child -> wait_target || child -> parent != thread_current())
+  struct thread *proc = process_current ();
+  struct user_thread *record;
+  struct thread_start start;
+  tid_t tid;
+
+  record = malloc (sizeof *record);
+  if (record == NULL)
+    return TID_ERROR;
+  record -> tid = TID_ERROR;
+  record -> joining = false;
+  record -> exited = false;
+
+  lock_acquire (&threads_lock);
+  for (record -> slot = 0; record -> slot < THREADS_MAX; record -> slot++)
+    if ((proc -> stack_slots & (1u << record -> slot)) == 0)
+      break;
+  if (proc -> exiting || record -> slot == THREADS_MAX)
+  {
+    lock_release (&threads_lock);
+    free (record);
+    return TID_ERROR;
+  }
+  proc -> stack_slots |= 1u << record -> slot;
+  list_push_back (&proc -> threads, &record -> elem);
+  lock_release (&threads_lock);
+
+  start.process = proc;
+  start.record = record;
+  start.eip = eip;
+  start.fn = fn;
+  start.aux = aux;
+  sema_init (&start.started, 0);
+  tid = thread_create (proc -> name, PRI_DEFAULT, start_thread, &start);
+  if (tid == TID_ERROR)
+  {
+    lock_acquire (&threads_lock);
+    proc -> stack_slots &= ~(1u << record -> slot);
+    list_remove (&record -> elem);
+    lock_release (&threads_lock);
+    free (record);
+    return TID_ERROR;
+  }
+  record -> tid = tid;
+
+  /* START lives on our stack. */
+  sema_down (&start.started);
+  if (!start.success)
+  {
+    process_thread_join (tid);
+    return TID_ERROR;
+  }
+  return tid;
+}
+
+/* A thread function that starts a thread of an existing user
+   process. */
+static void
+start_thread (void *start_)
+{
+  struct thread_start *start = start_;
+  struct thread *cur = thread_current ();
+  struct intr_frame if_;
+  uint32_t *sp;
+  bool success;
+
+  cur -> process = start -> process;
+  cur -> user_thread = start -> record;
+  cur -> exit_status = -1;  // unless it calls thread_exit()
+  cur -> pagedir = start -> process -> pagedir;
+  process_activate ();
+
+  memset (&if_, 0, sizeof if_);
+  if_.gs = if_.fs = if_.es = if_.ds = if_.ss = SEL_UDSEG;
+  if_.cs = SEL_UCSEG;
+  if_.eflags = FLAG_IF | FLAG_MBS;
+  if_.eip = start -> eip;
+
+  /* Call EIP (FN, AUX) with a null return address. */
+  sp = (uint32_t *) ((uint8_t *) PHYS_BASE - STACK_MAX
+                     - start -> record -> slot * THREAD_STACK_SIZE);
+  cur -> esp = sp;
+  success = pin_user_buffer (sp - 3, 3 * sizeof *sp, true);
+  if (success)
   {
+    sp[-1] = (uint32_t) start -> aux;
+    sp[-2] = (uint32_t) start -> fn;
+    sp[-3] = 0;
+    unpin_user_buffer (sp - 3, 3 * sizeof *sp);
+    if_.esp = sp - 3;
+  }
+
+  /* START is not valid after. */
+  start -> success = success;
+  sema_up (&start -> started);
+
+  if (!success)
+  {
+    cur -> exit_status = 0;
+    thread_exit ();
+  }
+
+  asm volatile ("movl %0, %%esp; jmp intr_exit" : : "g" (&if_) : "memory");
+  NOT_REACHED ();
+}
+
+/* Waits for thread TID of the current process, other than the
+   main thread, to end.  Returns 0, or -1 at once if TID is not
+   such a thread, is the caller, or has already been joined, or
+   if the process starts exiting before TID does. */
+int
+process_thread_join (tid_t tid)
+{
+  struct thread *proc = process_current ();
+  struct user_thread *record = NULL;
+  struct list_elem *e;
+  int result = -1;
+
+  if (tid == thread_tid ())
     return -1;
+  lock_acquire (&threads_lock);
+  for (e = list_begin (&proc -> threads); e != list_end (&proc -> threads);
+       e = list_next (e))
+    if (list_entry (e, struct user_thread, elem) -> tid == tid)
+    {
+      record = list_entry (e, struct user_thread, elem);
+      break;
+    }
+  if (record != NULL && !record -> joining)
+  {
+    /* Leave the record in THREADS, for wait_threads() to find if
+       we give up. */
+    record -> joining = true;
+    while (!record -> exited && !proc -> exiting)
+      cond_wait (&threads_changed, &threads_lock);
+    record -> joining = false;
+    if (record -> exited)
+    {
+      list_remove (&record -> elem);
+      free (record);
+      result = 0;
+    }
+    cond_broadcast (&threads_changed, &threads_lock);
   }
-  child -> wait_target = true;
-  child -> die = false;
-  while (!(child -> die))
+  lock_release (&threads_lock);
+  return result;
+}
+
+/* Ends the current thread normally.  In the main thread, waits
+   for all the others to end and returns, so that the caller can
+   end the process. */
+void
+process_thread_exit (void)
+{
+  struct thread *cur = thread_current ();
+
+  if (cur -> process != cur)
   {
-    thread_yield ();
+    cur -> exit_status = 0;
+    thread_exit ();
+  }
+  wait_threads (cur);
+}
+
+/* Marks the current process as exiting, so that all its threads
+   end, and wakes those of them that are waiting.  Returns true if
+   it was not already. */
+bool
+process_begin_exit (void)
+{
+  struct thread *proc = process_current ();
+  bool first;
+
+  lock_acquire (&threads_lock);
+  first = !proc -> exiting;
+  proc -> exiting = true;
+  cond_broadcast (&threads_changed, &threads_lock);
+  lock_release (&threads_lock);
+  if (first)
+  {
+    lock_acquire (&child_lock);
+    cond_broadcast (&child_exited, &child_lock);
+    lock_release (&child_lock);
+    futex_cancel (proc);
+    pipe_cancel ();
   }
-  return thread_current() -> child_exit_status;
+  return first;
+}
+
+/* Returns true if the current thread belongs to a user process
+   that is exiting, and so should stop waiting.  A waiter must
+   check this under the lock its waker holds when broadcasting. */
+bool
+process_exiting (void)
+{
+  struct thread *cur = thread_current ();
+
+  return cur -> pagedir != NULL && cur -> process -> exiting;
+}
+
+/* Ends the current thread if it is a user thread whose process
+   is exiting.  Called on the way back to user mode. */
+void
+process_check_exit (void)
+{
+  struct thread *cur = thread_current ();
+
+  if (cur -> pagedir != NULL && cur -> process -> exiting)
+  {
+    intr_enable ();
+    thread_exit ();
+  }
+}
+
+/* Waits for every thread of PROCESS but the main one to end,
+   and for any thread joining one of them to give up. */
+static void
+wait_threads (struct thread *process)
+{
+  lock_acquire (&threads_lock);
+  while (!list_empty (&process -> threads))
+  {
+    struct list_elem *e, *next;
+
+    for (e = list_begin (&process -> threads);
+         e != list_end (&process -> threads); e = next)
+    {
+      struct user_thread *record = list_entry (e, struct user_thread, elem);
+      next = list_next (e);
+      if (record -> exited && !record -> joining)
+      {
+        list_remove (&record -> elem);
+        free (record);
+      }
+    }
+    if (!list_empty (&process -> threads))
+      cond_wait (&threads_changed, &threads_lock);
+  }
+  lock_release (&threads_lock);
+}
+
+/* Releases thread T, which is not the main thread of its
+   process.  A thread that did not end through thread_exit() died
+   of an exception, and takes the process with it. */
+static void
+end_thread (struct thread *t)
+{
+  struct thread *proc = t -> process;
+
+  if (t -> exit_status != 0)
+    process_begin_exit ();
+
+  /* The main thread destroys the page directory once it knows we
+     are done with it. */
+  t -> pagedir = NULL;
+  pagedir_activate (NULL);
+  lock_acquire (&threads_lock);
+  proc -> stack_slots &= ~(1u << t -> user_thread -> slot);
+  t -> user_thread -> exited = true;
+  cond_broadcast (&threads_changed, &threads_lock);
+  lock_release (&threads_lock);
 }
 
 /* Free the current process's resources. */
@@ -204,26 +737,81 @@ void
 process_exit (void)
 {
   struct thread *cur = thread_current ();
-  destroy_page_table(&cur -> page_table);
-  cur -> parent -> child_exit_status = cur -> exit_status;
-  uint32_t *pd;
-  /* Destroy the current process's page directory and switch back
-     to the kernel-only page directory. */
-  pd = cur->pagedir;
+
+  if (cur -> process != cur)
+  {
+    end_thread (cur);
+    return;
+  }
+  if (cur -> pagedir != NULL)
+  {
+    process_begin_exit ();
+    wait_threads (cur);
+
+    if (vm_print_stats)
+      printf ("%s: vm: %u minor faults, %u major faults, %u evictions, "
+              "%u swap-ins, %u resident, %u working set\n",
+              cur -> name, cur -> minor_faults, cur -> major_faults,
+              cur -> evictions, cur -> swap_ins, cur -> resident_cnt,
+              cur -> working_set);
+  }
+
+  /* Switch back to the kernel-only page directory before taking
+     the process apart.  Correct ordering here is crucial.  We
+     must set cur->pagedir to NULL before switching page
+     directories, so that a timer interrupt can't switch back to
+     the process page directory, and the page directory must not
+     be active once its frames are freed. */
+  int64_t start = timer_usecs ();
+  uint32_t *pd = cur->pagedir;
+  size_t page_cnt = 0;
   if (pd != NULL)
-    {
-      /* Correct ordering here is crucial.  We must set
-         cur->pagedir to NULL before switching page directories,
-         so that a timer interrupt can't switch back to the
-         process page directory.  We must activate the base page
-         directory before destroying the process's page
-         directory, or our active page directory will be one
-         that's been freed (and cleared). */
-      cur->pagedir = NULL;
-      pagedir_activate (NULL);
-      pagedir_destroy (pd);
-    }
-  cur -> die = true;
+  {
+    cur->pagedir = NULL;
+    pagedir_activate (NULL);
+    /* An eviction holds page_lock while it writes out a page. */
+    lock_acquire (&cur -> page_lock);
+    page_cnt = destroy_page_table (&cur -> page_table, pd);
+    lock_release (&cur -> page_lock);
+  }
+  close_all_files (cur);
+  shm_close_all (cur);
+  lock_acquire (&file_lock);
+  file_close (cur -> exec_file);
+  lock_release (&file_lock);
+  pagedir_destroy (pd);
+
+  /* Children we never waited for will not be waited for now. */
+  lock_acquire (&child_lock);
+  if (pd != NULL)
+  {
+    reap_cnt++;
+    reap_pages += page_cnt;
+    reap_usecs += timer_usecs () - start;
+  }
+  while (!list_empty (&cur -> children))
+  {
+    struct child_status *child
+      = list_entry (list_pop_front (&cur -> children),
+                    struct child_status, list_elem);
+    hash_delete (&child_table, &child -> elem);
+    lock_release (&child_lock);
+    release_status (child);
+    lock_acquire (&child_lock);
+  }
+  lock_release (&child_lock);
+
+  /* Leave our exit status for the parent. */
+  if (cur -> own_status != NULL)
+  {
+    lock_acquire (&child_lock);
+    cur -> own_status -> exit_status = cur -> exit_status;
+    cur -> own_status -> exited = true;
+    cond_broadcast (&child_exited, &child_lock);
+    lock_release (&child_lock);
+    release_status (cur -> own_status);
+    cur -> own_status = NULL;
+  }
 }
 
 /* Sets up the CPU for running user code in the current
@@ -311,33 +899,147 @@ static bool load_segment (struct file *file, off_t ofs, uint8_t *upage,
                           uint32_t read_bytes, uint32_t zero_bytes,
                           bool writable);
 
+/* What load() needs from an executable once its headers have
+   been read and checked: the entry point and one entry per
+   PT_LOAD segment.  Attached to the file's inode, so that running
+   the same program again skips the header parsing. */
+struct exec_segment
+  {
+    uint32_t file_page;         /* Page-aligned file offset. */
+    uint32_t mem_page;          /* Page-aligned user address. */
+    uint32_t read_bytes;        /* Bytes to read from the file. */
+    uint32_t zero_bytes;        /* Bytes to zero after them. */
+    bool writable;
+  };
+
+struct exec_image
+  {
+    Elf32_Addr entry;           /* Entry point. */
+    int seg_cnt;                /* Number of elements in SEGS. */
+    struct exec_segment segs[]; /* Loadable segments. */
+  };
+
+/* Exec statistics. */
+static long long exec_cnt;      /* Successful loads. */
+static long long exec_hits;     /* Of those, loads from a cached image. */
+static long long exec_usecs;    /* Time spent in them. */
+
+static struct exec_image *parse_image (struct file *, const char *file_name);
+
 /* Loads an ELF executable from FILE_NAME into the current thread.
    Stores the executable's entry point into *EIP
    and its initial stack pointer into *ESP.
-   Returns true if successful, false otherwise. */
+   Returns true if successful, false otherwise.
+
+   The file system lock is held only while the file is opened and
+   its headers are read, not while the stack is set up, which may
+   evict pages and wait for swap. */
 bool
 load (const char *file_name, void (**eip) (void), void **esp)
 {
   struct thread *t = thread_current ();
-  struct Elf32_Ehdr ehdr;
+  struct exec_image *image;
   struct file *file = NULL;
-  off_t file_ofs;
+  int64_t start = timer_usecs ();
+  bool hit = false;
+  bool owned = false;
   bool success = false;
   int i;
 
   /* Allocate and activate page directory. */
   t->pagedir = pagedir_create ();
   if (t->pagedir == NULL)
-    goto done;
+    return false;
   process_activate ();
 
-  /* Open executable file. */
+  /* Open executable file.  Segments are loaded lazily from it,
+     so it must not change from here on. */
+  lock_acquire (&file_lock);
   file = filesys_open (file_name);
   if (file == NULL)
     {
+      lock_release (&file_lock);
       printf ("load: %s: open failed\n", file_name);
       goto done;
     }
+  file_deny_write (file);
+
+  /* Read and verify its headers, unless that was already done
+     for an earlier run. */
+  inode_exec_lock ();
+  image = inode_exec_image (file_get_inode (file));
+  hit = image != NULL;
+  if (image == NULL)
+    {
+      image = parse_image (file, file_name);
+      if (image != NULL)
+        owned = !inode_set_exec_image (file_get_inode (file), image);
+    }
+  lock_release (&file_lock);
+  if (image == NULL)
+    {
+      inode_exec_unlock ();
+      goto done;
+    }
+
+  success = true;
+  for (i = 0; i < image->seg_cnt && success; i++)
+    {
+      struct exec_segment *seg = &image->segs[i];
+      success = load_segment (file, seg->file_page, (void *) seg->mem_page,
+                              seg->read_bytes, seg->zero_bytes,
+                              seg->writable);
+    }
+
+  /* Start address. */
+  *eip = (void (*) (void)) image->entry;
+  if (owned)
+    free (image);
+  inode_exec_unlock ();
+
+  /* Set up stack. */
+  if (success)
+    success = setup_stack (esp);
+
+ done:
+  /* We arrive here whether the load is successful or not.
+     Keep FILE open for the life of the process. */
+  lock_acquire (&file_lock);
+  if (success)
+    {
+      t->exec_file = file;
+      exec_cnt++;
+      if (hit)
+        exec_hits++;
+      exec_usecs += timer_usecs () - start;
+    }
+  else
+    file_close (file);
+  lock_release (&file_lock);
+  return success;
+}
+
+/* Prints exec and teardown statistics. */
+void
+process_print_stats (void)
+{
+  printf ("Exec: %lld loads, %lld from cached headers, "
+          "%lld us average\n",
+          exec_cnt, exec_hits, exec_cnt > 0 ? exec_usecs / exec_cnt : 0);
+  printf ("Reap: %lld processes, %lld pages, %lld us average\n",
+          reap_cnt, reap_pages, reap_cnt > 0 ? reap_usecs / reap_cnt : 0);
+}
+
+/* Reads and verifies the headers of executable FILE, and returns
+   its layout in a block obtained from malloc(), or a null pointer
+   if FILE is not a valid executable. */
+static struct exec_image *
+parse_image (struct file *file, const char *file_name)
+{
+  struct Elf32_Ehdr ehdr;
+  struct exec_image *image;
+  off_t file_ofs;
+  int i;
 
   /* Read and verify executable header. */
   if (file_read (file, &ehdr, sizeof ehdr) != sizeof ehdr
@@ -349,9 +1051,15 @@ load (const char *file_name, void (**eip) (void), void **esp)
       || ehdr.e_phnum > 1024)
     {
       printf ("load: %s: error loading executable\n", file_name);
-      goto done;
+      return NULL;
     }
 
+  image = malloc (sizeof *image + ehdr.e_phnum * sizeof *image->segs);
+  if (image == NULL)
+    return NULL;
+  image->entry = ehdr.e_entry;
+  image->seg_cnt = 0;
+
   /* Read program headers. */
   file_ofs = ehdr.e_phoff;
   for (i = 0; i < ehdr.e_phnum; i++)
@@ -359,11 +1067,11 @@ load (const char *file_name, void (**eip) (void), void **esp)
       struct Elf32_Phdr phdr;
 
       if (file_ofs < 0 || file_ofs > file_length (file))
-        goto done;
+        goto error;
       file_seek (file, file_ofs);
 
       if (file_read (file, &phdr, sizeof phdr) != sizeof phdr)
-        goto done;
+        goto error;
       file_ofs += sizeof phdr;
       switch (phdr.p_type)
         {
@@ -377,55 +1085,46 @@ load (const char *file_name, void (**eip) (void), void **esp)
         case PT_DYNAMIC:
         case PT_INTERP:
         case PT_SHLIB:
-          goto done;
+          goto error;
         case PT_LOAD:
           if (validate_segment (&phdr, file))
             {
-              bool writable = (phdr.p_flags & PF_W) != 0;
-              uint32_t file_page = phdr.p_offset & ~PGMASK;
-              uint32_t mem_page = phdr.p_vaddr & ~PGMASK;
+              struct exec_segment *seg = &image->segs[image->seg_cnt++];
               uint32_t page_offset = phdr.p_vaddr & PGMASK;
-              uint32_t read_bytes, zero_bytes;
+
+              seg->writable = (phdr.p_flags & PF_W) != 0;
+              seg->file_page = phdr.p_offset & ~PGMASK;
+              seg->mem_page = phdr.p_vaddr & ~PGMASK;
               if (phdr.p_filesz > 0)
                 {
                   /* Normal segment.
                      Read initial part from disk and zero the rest. */
-                  read_bytes = page_offset + phdr.p_filesz;
-                  zero_bytes = (ROUND_UP (page_offset + phdr.p_memsz, PGSIZE)
-                                - read_bytes);
+                  seg->read_bytes = page_offset + phdr.p_filesz;
+                  seg->zero_bytes = (ROUND_UP (page_offset + phdr.p_memsz,
+                                               PGSIZE)
+                                     - seg->read_bytes);
                 }
               else
                 {
                   /* Entirely zero.
                      Don't read anything from disk. */
-                  read_bytes = 0;
-                  zero_bytes = ROUND_UP (page_offset + phdr.p_memsz, PGSIZE);
+                  seg->read_bytes = 0;
+                  seg->zero_bytes = ROUND_UP (page_offset + phdr.p_memsz,
+                                              PGSIZE);
                 }
-              if (!load_segment (file, file_page, (void *) mem_page,
-                                 read_bytes, zero_bytes, writable))
-                goto done;
             }
           else
-            goto done;
+            goto error;
           break;
         }
     }
+  return image;
 
-  /* Set up stack. */
-  if (!setup_stack (esp))
-    goto done;
-
-  /* Start address. */
-  *eip = (void (*) (void)) ehdr.e_entry;
-
-  success = true;
-
- done:
-  /* We arrive here whether the load is successful or not. */
-  file_close (file);
-  return success;
+ error:
+  free (image);
+  return NULL;
 }
-
+
 /* load() helpers. */
 
 // static bool install_page (void *upage, void *kpage, bool writable);
@@ -514,6 +1213,9 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
       page -> valid_bit = false;
       page -> file = file;
       page -> offset = ofs;
+      page -> swap_slot = SWAP_NONE;
+      page -> cow = false;
+      page -> shared = false;
       page -> read_bytes = page_read_bytes;
       page -> zero_bytes = page_zero_bytes;
       page -> writable = writable;
@@ -547,6 +1249,7 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
       //   }
 
       /* Advance. */
+      ofs += page_read_bytes;
       read_bytes -= page_read_bytes;
       zero_bytes -= page_zero_bytes;
       upage += PGSIZE;
@@ -559,7 +1262,6 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
 static bool
 setup_stack (void **esp)
 {
-    printf("%s\n", "start of setup stack");
     bool success = grow_stack (((uint8_t *) PHYS_BASE) - PGSIZE);
     if (!success)
     {
@@ -567,7 +1269,6 @@ setup_stack (void **esp)
     }
 
     *esp = PHYS_BASE;
-    printf("%s\n", "end of setup stack");
     return true;
 
     // // uint8_t *kpage;
@@ -1,12 +1,24 @@
 #ifndef USERPROG_PROCESS_H
 #define USERPROG_PROCESS_H
 
+#include <syscall-nr.h>
 #include "threads/thread.h"
 
+void process_init (void);
 tid_t process_execute (const char *file_name);
+tid_t process_spawn (const char *file_name,
+                     const struct spawn_action *actions, int action_cnt);
 int process_wait (tid_t);
 void process_exit (void);
+struct thread *process_current (void);
+tid_t process_thread_spawn (void (*eip) (void), void *fn, void *aux);
+int process_thread_join (tid_t);
+void process_thread_exit (void);
+bool process_begin_exit (void);
+bool process_exiting (void);
+void process_check_exit (void);
 void process_activate (void);
 bool install_page (void *upage, void *kpage, bool writable);
+void process_print_stats (void);
 
 #endif /* userprog/process.h */
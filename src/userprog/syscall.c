@@ -1,36 +1,63 @@
 #include "userprog/syscall.h"
 #include <stdio.h>
+#include <string.h>
 #include <syscall-nr.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 #include "threads/init.h"
+#include "threads/malloc.h"
 #include "filesys/filesys.h"
 #include "filesys/file.h"
 #include "threads/vaddr.h"
+#include "userprog/futex.h"
 #include "userprog/pagedir.h"
+#include "userprog/pipe.h"
+#include "userprog/process.h"
 #include <list.h>
 #include "threads/synch.h"
 #include "vm/page.h"
+#include "vm/shm.h"
 
 
 static void syscall_handler (struct intr_frame *);
 
+/* Open files of all processes, told apart by their caller.
+   Protected by file_lock. */
 static struct list opfilelist;
 struct lock file_lock;
 
+static struct openedfile *lookup_fd (struct thread *, int fd);
+static int next_fd (struct thread *);
+static void add_fd (struct openedfile *, int fd, struct thread *);
+static void remove_fd (struct openedfile *);
+static void string_check (const char *);
+static int open_shm (const char *name, unsigned size);
+static unsigned io_chunk (const void *buf, unsigned size, int pages);
+
+/* Most pages of a user buffer that read() and write() pin at
+   once for a file or the console.  Larger buffers go through in
+   pieces, so that they need not fit in memory.  Pipes, which may
+   block, go a page at a time. */
+#define IO_PAGES 8
+
 void address_check (void * addr, void * esp)
 {
-  // return true;
-  //if (!is_user_vaddr(addr) || !pagedir_get_page(thread_current()->pagedir, addr))
-  if (!(in_valid_range(addr) && load_page(find_page(addr))))
+  if (!in_valid_range(addr))
     exit(-1);
+  if (pagedir_get_page(thread_current()->pagedir, addr) != NULL)
+    return;
+
+  struct lock *page_lock = &process_current () -> page_lock;
+  bool success = false;
+  lock_acquire (page_lock);
+  struct page *page = find_page(addr);
+  if (page != NULL)
+    success = load_page(page);
   else if (addr >= esp - 32)
-  {
-    if(!grow_stack(addr))
-      exit(-1);
-  }
-  else
-	  return;
+    success = grow_stack(addr);
+  lock_release (page_lock);
+  if (!success)
+    exit(-1);
 }
 
 bool create (const char * file, unsigned initial_size)
@@ -86,57 +113,32 @@ int open (const char * file)
   // // check whether the file pointer is valid
   // address_check(file);
 
-  static int nextfd = 2;
+  if (file == NULL)
+    return -1;
   struct openedfile * opfile = malloc (sizeof(struct openedfile) * 1);
-  if (file != NULL)
+  if (opfile == NULL)
+    return -1;
+  lock_acquire(&file_lock);
+  opfile -> file = filesys_open (file);
+  opfile -> pipe = NULL;
+  if (opfile -> file == NULL)
   {
-    lock_acquire(&file_lock);
-    opfile -> file = filesys_open (file);
-    if (opfile -> file == NULL)
-    {
-      lock_release(&file_lock);
-      return -1;
-    }
-    // printf("%s %d\n", "file open", nextfd);
-    opfile -> fd = nextfd;
-    opfile -> caller = thread_current();
-    list_push_front (&opfilelist, &(opfile -> opelem));
-    nextfd++;
     lock_release(&file_lock);
-    return opfile -> fd;
-  }
-  else
+    free (opfile);
     return -1;
+  }
+  add_fd (opfile, next_fd (process_current ()), process_current ());
+  lock_release(&file_lock);
+  return opfile -> fd;
 }
 
 void close (int fd)
 {
-  if(!list_empty(&opfilelist))
-  {
-    struct openedfile * now = list_entry(list_front(&opfilelist), struct openedfile, opelem);
-    do
-    {
-      if (now -> fd == fd)
-      {
-        if (now -> caller -> tid == thread_current() -> tid)
-        {
-          lock_acquire(&file_lock);
-          file_close (now -> file);
-          lock_release(&file_lock);
-          list_remove(&(now->opelem));
-          free(now);
-          return;
-        }
-        else
-        {
-          exit(-1);
-          return;
-        }
-      }
-      now = list_entry(list_next(&(now->opelem)), struct openedfile, opelem);
-    } while(now->opelem.next == NULL);
-  }
-  return;
+  lock_acquire(&file_lock);
+  struct openedfile * now = lookup_fd (process_current (), fd);
+  if (now != NULL)
+    remove_fd (now);
+  lock_release(&file_lock);
 }
 
 void halt ()
@@ -144,72 +146,182 @@ void halt ()
   shutdown_power_off();
 }
 
+// end the process, with all its threads; the first thread to
+// exit decides the status
 void exit (int status)
 {
-  if(!list_empty(&opfilelist))
+  if (process_begin_exit ())
+  {
+    printf ("%s: exit(%d)\n", process_current ()->name, status);
+    process_current ()->exit_status = status;
+  }
+  thread_exit();
+}
+
+/* Closes every file T has open.  Called as T exits. */
+void close_all_files (struct thread *t)
+{
+  struct list_elem *e, *next;
+
+  lock_acquire(&file_lock);
+  for (e = list_begin (&opfilelist); e != list_end (&opfilelist); e = next)
   {
-    struct openedfile * now = list_entry(list_front(&opfilelist), struct openedfile, opelem);
-    do
+    struct openedfile *now = list_entry (e, struct openedfile, opelem);
+    next = list_next (e);
+    if (now -> caller == t)
+      remove_fd (now);
+  }
+  lock_release(&file_lock);
+}
+
+/* Gives T, a new process, the files its parent PARENT asks for in
+   the CNT elements of ACTIONS, applied in order.  PARENT must be
+   blocked until this returns.  Returns false if an action names a
+   descriptor that does not exist. */
+bool apply_spawn_actions (struct thread *t, struct thread *parent,
+                          const struct spawn_action *actions, int cnt)
+{
+  bool success = true;
+  int i;
+
+  lock_acquire(&file_lock);
+  for (i = 0; i < cnt && success; i++)
+  {
+    const struct spawn_action *a = &actions[i];
+    struct openedfile *now = lookup_fd (t, a -> type == SPAWN_DUP
+                                           ? a -> newfd : a -> fd);
+    if (now != NULL)
+      remove_fd (now);
+
+    if (a -> type == SPAWN_DUP)
     {
-      if (now -> caller == thread_current())
+      struct openedfile *src = lookup_fd (parent, a -> fd);
+      struct openedfile *dst;
+      if (src == NULL)
       {
-        lock_acquire(&file_lock);
-        file_close (now -> file);
-        lock_release(&file_lock);
-        list_remove(&(now->opelem));
-        free(now);
-        break;
+        // the console, which the child has already
+        success = (a -> fd == 0 || a -> fd == 1) && a -> newfd == a -> fd;
+        continue;
+      }
+      dst = a -> newfd >= 0 ? malloc (sizeof *dst) : NULL;
+      if (dst == NULL)
+      {
+        success = false;
+        continue;
+      }
+      dst -> file = NULL;
+      dst -> pipe = NULL;
+      dst -> writer = src -> writer;
+      if (src -> pipe != NULL)
+        dst -> pipe = pipe_reopen (src -> pipe, src -> writer);
+      else if ((dst -> file = file_reopen (src -> file)) != NULL)
+        // a reopened file has its own position, so start it where
+        // the parent's is
+        file_seek (dst -> file, file_tell (src -> file));
+      else
+      {
+        free (dst);
+        success = false;
+        continue;
       }
-      now = list_entry(list_next(&(now->opelem)), struct openedfile, opelem);
-    } while(now->opelem.next != NULL);
+      add_fd (dst, a -> newfd, t);
+    }
+    else if (a -> type != SPAWN_CLOSE)
+      success = false;
   }
-  printf ("%s: exit(%d)\n", thread_current ()->name, status);
-  thread_current()->exit_status = status;
-  thread_exit();
+  lock_release(&file_lock);
+  return success;
 }
 
-
 int write (int fd , const void * buffer , unsigned size )
 {
   // check whether the buffer address is valid or not
   // address_check(&buffer);
   // address_check(buffer);
 
+  int byte = -1;
+  lock_acquire(&file_lock);
+  struct openedfile * now = lookup_fd (process_current (), fd);
+  struct pipe * pipe = now != NULL ? now -> pipe : NULL;
+  bool writer = now != NULL && now -> writer;
+  // a sibling thread may close FD while we use the pipe
+  if (pipe != NULL)
+    pipe_reopen (pipe, writer);
+  lock_release(&file_lock);
+
   // stdin
-  if (fd == 0)
+  if (now == NULL && fd == 0)
   {
     exit(-1);
   }
 
-  if (fd == 1)
+  // a pipe may block, so not under file_lock, and may block for
+  // long, so only the page being written is pinned
+  if (pipe != NULL)
   {
-    putbuf (buffer,size);
-    return size;
-  }
-  else
-  {
-    // if there is no opened file
-    if (list_empty(&opfilelist))
+    byte = writer ? 0 : -1;
+    while (writer && (unsigned) byte < size)
     {
-      return -1;
-    }
+      const uint8_t * chunk = (const uint8_t *) buffer + byte;
+      unsigned n = io_chunk (chunk, size - byte, 1);
+      int moved;
 
-    lock_acquire(&file_lock);
-    int byte = 0;
-    struct openedfile * now = list_entry(list_front(&opfilelist), struct openedfile, opelem);
-    do
-    {
-      if ((now -> fd) == fd)
+      if (!pin_user_buffer (chunk, n, false))
+      {
+        if (byte > 0)
+          break;
+        pipe_close (pipe, writer);
+        exit(-1);
+      }
+      moved = pipe_write (pipe, chunk, n);
+      unpin_user_buffer (chunk, n);
+      if (moved < 0)
       {
-        byte = file_write (now -> file, buffer, size);
+        if (byte == 0)
+          byte = -1;
         break;
       }
-      now = list_entry(list_next(&(now->opelem)), struct openedfile, opelem);
-    } while(now->opelem.next != NULL);
-    lock_release(&file_lock);
-
+      byte += moved;
+    }
+    pipe_close (pipe, writer);
     return byte;
   }
+
+  // a file, or the console unless redirected above
+  if (now == NULL && fd != 1)
+    return -1;
+  unsigned done = 0;
+  while (done < size)
+  {
+    const uint8_t * chunk = (const uint8_t *) buffer + done;
+    unsigned n = io_chunk (chunk, size - done, IO_PAGES);
+    int moved = n;
+
+    if (!pin_user_buffer (chunk, n, false))
+    {
+      if (done == 0)
+        exit(-1);
+      break;
+    }
+    if (now != NULL)
+    {
+      lock_acquire(&file_lock);
+      now = lookup_fd (process_current (), fd);
+      moved = now != NULL && now -> pipe == NULL
+              ? file_write (now -> file, chunk, n) : -1;
+      lock_release(&file_lock);
+    }
+    else
+      putbuf ((const char *) chunk, n);
+    unpin_user_buffer (chunk, n);
+
+    if (moved < 0)
+      return done > 0 ? (int) done : -1;
+    done += moved;
+    if ((unsigned) moved < n)
+      break;
+  }
+  return done;
 }
 
 void get_args (struct intr_frame * f, int * arg, int num_args)
@@ -227,18 +339,11 @@ void get_args (struct intr_frame * f, int * arg, int num_args)
 
 int filesize (int fd)
 {
-  int size = 0;
-  struct openedfile * now = list_entry(list_front(&opfilelist), struct openedfile, opelem);
+  int size = -1;
   lock_acquire(&file_lock);
-  do
-  {
-    if ((now -> fd) == fd)
-    {
-      size = file_length (now -> file);
-      break;
-    }
-    now = list_entry(list_next(&(now->opelem)), struct openedfile, opelem);
-  } while(now->opelem.next != NULL);
+  struct openedfile * now = lookup_fd (process_current (), fd);
+  if (now != NULL && now -> pipe == NULL)
+    size = file_length (now -> file);
   lock_release (&file_lock);
 
   return size;
@@ -247,35 +352,22 @@ int filesize (int fd)
 unsigned tell (int fd)
 {
   off_t offset = 0;
-  struct openedfile * now = list_entry(list_front(&opfilelist), struct openedfile, opelem);
-  do
-  {
-    if ((now -> fd) == fd)
-    {
-      lock_acquire(&file_lock);
-      offset = file_tell (now -> file);
-      lock_release(&file_lock);
-      break;
-    }
-    now = list_entry(list_next(&(now->opelem)), struct openedfile, opelem);
-  } while(now->opelem.next != NULL);
+  lock_acquire(&file_lock);
+  struct openedfile * now = lookup_fd (process_current (), fd);
+  if (now != NULL && now -> pipe == NULL)
+    offset = file_tell (now -> file);
+  lock_release(&file_lock);
 
   return offset;
 }
 
 void seek (int fd, unsigned position)
 {
-  struct openedfile * now = list_entry(list_front(&opfilelist), struct openedfile, opelem);
-  do
-  {
-    if ((now -> fd) == fd)
-    {
-      lock_acquire(&file_lock);
-      file_seek (now -> file, position);
-      lock_release(&file_lock);
-    }
-    now = list_entry(list_next(&(now->opelem)), struct openedfile, opelem);
-  } while(now->opelem.next != NULL);
+  lock_acquire(&file_lock);
+  struct openedfile * now = lookup_fd (process_current (), fd);
+  if (now != NULL && now -> pipe == NULL)
+    file_seek (now -> file, position);
+  lock_release(&file_lock);
 }
 
 int read (int fd, const void *buffer, unsigned size)
@@ -283,47 +375,94 @@ int read (int fd, const void *buffer, unsigned size)
   // check whether the buffer address is valid or not
   // address_check(buffer);
 
-  // stdout fd
-  if (fd == 1)
+  int byte = -1;
+  lock_acquire(&file_lock);
+  struct openedfile * now = lookup_fd (process_current (), fd);
+  struct pipe * pipe = now != NULL ? now -> pipe : NULL;
+  bool writer = now != NULL && now -> writer;
+  // a sibling thread may close FD while we use the pipe
+  if (pipe != NULL)
+    pipe_reopen (pipe, writer);
+  lock_release(&file_lock);
+
+  // stdout
+  if (now == NULL && fd == 1)
   {
     exit(-1);
   }
 
-  // stdin
-  if (fd == 0)
+  // a pipe may block, so not under file_lock, and may block for
+  // long, so only the page being filled is pinned; only the first
+  // page waits for data
+  if (pipe != NULL)
   {
-    unsigned i;
-    int * temp_buffer = buffer;
-    for (i = 0; i < size; i++)
+    byte = !writer ? 0 : -1;
+    while (!writer && (unsigned) byte < size)
     {
-      temp_buffer[i] = input_getc();
-      return size;
+      uint8_t * chunk = (uint8_t *) buffer + byte;
+      unsigned n = io_chunk (chunk, size - byte, 1);
+      int moved;
+
+      if (!pin_user_buffer (chunk, n, true))
+      {
+        if (byte > 0)
+          break;
+        pipe_close (pipe, writer);
+        exit(-1);
+      }
+      moved = pipe_read (pipe, chunk, n, byte == 0);
+      unpin_user_buffer (chunk, n);
+      if (moved < 0 && byte == 0)
+        byte = -1;
+      if (moved <= 0)
+        break;
+      byte += moved;
+      if ((unsigned) moved < n)
+        break;
     }
+    pipe_close (pipe, writer);
+    return byte;
   }
-  else
+
+  // a file, or the keyboard unless redirected above
+  if (now == NULL && fd != 0)
+    return -1;
+  unsigned done = 0;
+  while (done < size)
   {
-    // if there is no opened file
-    if (list_empty(&opfilelist))
+    uint8_t * chunk = (uint8_t *) buffer + done;
+    unsigned n = io_chunk (chunk, size - done, IO_PAGES);
+    int moved = n;
+
+    if (!pin_user_buffer (chunk, n, true))
     {
-      return -1;
+      if (done == 0)
+        exit(-1);
+      break;
     }
-
-    int byte = -1;
-    lock_acquire(&file_lock);
-    struct openedfile * now = list_entry(list_front(&opfilelist), struct openedfile, opelem);
-    do
+    if (now != NULL)
     {
-      if ((now -> fd) == fd)
-      {
-        byte = file_read (now -> file, buffer, size);
-        break;
-      }
-      now = list_entry(list_next(&(now->opelem)), struct openedfile, opelem);
-    } while(now->opelem.next != NULL);
-    lock_release(&file_lock);
+      lock_acquire(&file_lock);
+      now = lookup_fd (process_current (), fd);
+      moved = now != NULL && now -> pipe == NULL
+              ? file_read (now -> file, chunk, n) : -1;
+      lock_release(&file_lock);
+    }
+    else
+    {
+      unsigned i;
+      for (i = 0; i < n; i++)
+        chunk[i] = input_getc();
+    }
+    unpin_user_buffer (chunk, n);
 
-    return byte;
+    if (moved < 0)
+      return done > 0 ? (int) done : -1;
+    done += moved;
+    if ((unsigned) moved < n)
+      break;
   }
+  return done;
 }
 
 bool remove (const char *file)
@@ -337,35 +476,148 @@ bool remove (const char *file)
 
 int exec (const char *cmd_line)
 {
-  // change the address from kernel to user memory
-  void *user_memory = pagedir_get_page(thread_current()->pagedir, cmd_line);
-  if (!user_memory)
+  string_check (cmd_line);
+  return process_execute (cmd_line);
+}
+
+// like exec, but first gives the child the descriptors ACTIONS
+// ask for, all in this one call
+int spawn (const char *cmd_line, const struct spawn_action *actions,
+           int action_cnt)
+{
+  string_check (cmd_line);
+  if (action_cnt < 0 || action_cnt > SPAWN_ACTIONS_MAX)
+    return -1;
+
+  // copy the actions, since the child applies them
+  size_t size = action_cnt * sizeof *actions;
+  struct spawn_action *copy = malloc (size > 0 ? size : 1);
+  if (copy == NULL)
+    return -1;
+  if (!pin_user_buffer (actions, size, false))
   {
+    free (copy);
     exit(-1);
   }
-  // lock_acquire(&file_lock);
-    int result = process_execute (user_memory);
-  // lock_release(&file_lock);
+  memcpy (copy, actions, size);
+  unpin_user_buffer (actions, size);
+
+  int result = process_spawn (cmd_line, copy, action_cnt);
+  free (copy);
   return result;
 }
 
+// make every page of user string STR resident, however many it
+// spans, or exit if some of it is not valid user memory
+static void string_check (const char *str)
+{
+  const char *p = str;
+  for (;;)
+  {
+    address_check ((void *) p, thread_current () -> esp);
+    while (*p != '\0' && pg_ofs (p + 1) != 0)
+      p++;
+    if (*p == '\0')
+      break;
+    p++;
+  }
+}
+
 int wait (int pid)
 {
   return process_wait (pid);
 }
 
+// paging statistics of the calling process, -1 for unknown field
+int vmstat (int field)
+{
+  struct thread *t = process_current();
+  switch (field)
+  {
+    case VMSTAT_MINOR_FAULTS:
+      return t -> minor_faults;
+    case VMSTAT_MAJOR_FAULTS:
+      return t -> major_faults;
+    case VMSTAT_EVICTIONS:
+      return t -> evictions;
+    case VMSTAT_SWAP_INS:
+      return t -> swap_ins;
+    case VMSTAT_RESIDENT:
+      return t -> resident_cnt;
+    case VMSTAT_WORKING_SET:
+      return t -> working_set;
+    default:
+      return -1;
+  }
+}
+
+// cap the calling process at PAGES resident frames (0 for no cap),
+// returning the previous cap
+int memlimit (int pages)
+{
+  struct thread *t = process_current();
+  int old = t -> resident_limit;
+  if (pages < 0)
+    return -1;
+  t -> resident_limit = pages;
+  return old;
+}
+
+// open a pipe, storing its read end in FDS[0] and its write end
+// in FDS[1]
+bool pipe (int *fds)
+{
+  if (!pin_user_buffer (fds, 2 * sizeof *fds, true))
+    exit(-1);
+
+  struct thread *t = process_current ();
+  struct openedfile *ends[2];
+  struct pipe *p = pipe_create ();
+  ends[0] = malloc (sizeof *ends[0]);
+  ends[1] = malloc (sizeof *ends[1]);
+  if (p == NULL || ends[0] == NULL || ends[1] == NULL)
+  {
+    if (p != NULL)
+    {
+      pipe_close (p, false);
+      pipe_close (p, true);
+    }
+    free (ends[0]);
+    free (ends[1]);
+    unpin_user_buffer (fds, 2 * sizeof *fds);
+    return false;
+  }
+
+  int i;
+  lock_acquire(&file_lock);
+  for (i = 0; i < 2; i++)
+  {
+    ends[i] -> file = NULL;
+    ends[i] -> pipe = p;
+    ends[i] -> writer = i == 1;
+    add_fd (ends[i], next_fd (t), t);
+    fds[i] = ends[i] -> fd;
+  }
+  lock_release(&file_lock);
+  unpin_user_buffer (fds, 2 * sizeof *fds);
+  return true;
+}
+
 void
 syscall_init (void)
 {
   lock_init(&file_lock);
   intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
   list_init (&opfilelist);
+  futex_init ();
+  pipe_init ();
 }
 
 static void
 syscall_handler (struct intr_frame *f UNUSED)
 {
   int args[100];
+  thread_current ()->esp = f->esp;
   address_check (f->esp, f->esp);
   int * ptr = f -> esp;
   switch (*ptr) {
@@ -424,5 +676,131 @@ syscall_handler (struct intr_frame *f UNUSED)
       get_args(f, &args[0], 1);
       f -> eax = wait ((int) args[0]);
       break;
+    case SYS_VMSTAT:
+      get_args(f, &args[0], 1);
+      f -> eax = vmstat ((int) args[0]);
+      break;
+    case SYS_MEMLIMIT:
+      get_args(f, &args[0], 1);
+      f -> eax = memlimit ((int) args[0]);
+      break;
+    case SYS_PIPE:
+      get_args(f, &args[0], 1);
+      f -> eax = pipe ((int *) args[0]);
+      break;
+    case SYS_SPAWN:
+      get_args(f, &args[0], 3);
+      f -> eax = spawn ((char *) args[0], (struct spawn_action *) args[1],
+                        (int) args[2]);
+      break;
+    case SYS_SHM_OPEN:
+      get_args(f, &args[0], 2);
+      f -> eax = open_shm ((char *) args[0], (unsigned) args[1]);
+      break;
+    case SYS_SHM_MAP:
+      get_args(f, &args[0], 2);
+      f -> eax = (uint32_t) shm_map ((int) args[0], (void *) args[1]);
+      break;
+    case SYS_FUTEX_WAIT:
+      get_args(f, &args[0], 2);
+      address_check((void *) args[0], f->esp);
+      f -> eax = futex_wait ((int *) args[0], (int) args[1]);
+      break;
+    case SYS_FUTEX_WAKE:
+      get_args(f, &args[0], 2);
+      address_check((void *) args[0], f->esp);
+      f -> eax = futex_wake ((int *) args[0], (int) args[1]);
+      break;
+    case SYS_THREAD_SPAWN:
+      get_args(f, &args[0], 3);
+      f -> eax = process_thread_spawn ((void (*) (void)) args[0],
+                                       (void *) args[1], (void *) args[2]);
+      break;
+    case SYS_THREAD_JOIN:
+      get_args(f, &args[0], 1);
+      f -> eax = process_thread_join ((tid_t) args[0]);
+      break;
+    case SYS_THREAD_EXIT:
+      // in the main thread this returns once the others are done
+      process_thread_exit ();
+      exit (0);
+      break;
   }
+
+  // another thread may have ended the process meanwhile
+  process_check_exit ();
+}
+
+// open shared memory segment NAME, copying the name first so that
+// the segment code never touches user memory
+static int open_shm (const char *name, unsigned size)
+{
+  char copy[SHM_NAME_MAX + 2];
+
+  string_check (name);
+  strlcpy (copy, name, sizeof copy);
+  return shm_open (copy, size);
+}
+
+/* Returns T's open file FD, or a null pointer if it has none.
+   Caller must hold file_lock. */
+static struct openedfile *lookup_fd (struct thread *t, int fd)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&opfilelist); e != list_end (&opfilelist);
+       e = list_next (e))
+  {
+    struct openedfile *now = list_entry (e, struct openedfile, opelem);
+    if (now -> fd == fd && now -> caller == t)
+      return now;
+  }
+  return NULL;
+}
+
+/* Returns the descriptor T's next open() gets: one past the
+   highest it has, but never 0 or 1.  Caller must hold
+   file_lock. */
+static int next_fd (struct thread *t)
+{
+  struct list_elem *e;
+  int fd = 2;
+
+  for (e = list_begin (&opfilelist); e != list_end (&opfilelist);
+       e = list_next (e))
+  {
+    struct openedfile *now = list_entry (e, struct openedfile, opelem);
+    if (now -> caller == t && now -> fd >= fd)
+      fd = now -> fd + 1;
+  }
+  return fd;
+}
+
+/* Enters OPFILE as T's descriptor FD.  Caller must hold
+   file_lock. */
+static void add_fd (struct openedfile *opfile, int fd, struct thread *t)
+{
+  opfile -> fd = fd;
+  opfile -> caller = t;
+  list_push_front (&opfilelist, &opfile -> opelem);
+}
+
+/* Closes OPFILE and frees it.  Caller must hold file_lock. */
+static void remove_fd (struct openedfile *opfile)
+{
+  if (opfile -> pipe != NULL)
+    pipe_close (opfile -> pipe, opfile -> writer);
+  else
+    file_close (opfile -> file);
+  list_remove (&opfile -> opelem);
+  free (opfile);
+}
+
+/* Returns how many of the SIZE bytes at BUF read() and write()
+   move at once: those up to the end of the PAGES pages that
+   start with BUF's page. */
+static unsigned io_chunk (const void *buf, unsigned size, int pages)
+{
+  unsigned max = pages * PGSIZE - pg_ofs (buf);
+  return size < max ? size : max;
 }
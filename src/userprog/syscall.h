@@ -2,12 +2,25 @@
 #ifndef USERPROG_SYSCALL_H
 #define USERPROG_SYSCALL_H
 
+#include <syscall-nr.h>
+#include "threads/synch.h"
+
+struct thread;
+
+/* Serializes all file system access from system calls. */
+extern struct lock file_lock;
+
 void syscall_init (void);
+void close_all_files (struct thread *);
+bool apply_spawn_actions (struct thread *, struct thread *parent,
+                          const struct spawn_action *, int cnt);
 
 struct openedfile
 {
     int fd;
-    struct file * file;
+    struct file * file;         /* Open file, or NULL for a pipe. */
+    struct pipe * pipe;         /* Pipe, or NULL for a file. */
+    bool writer;                /* Write end of PIPE? */
     struct list_elem opelem;
     struct thread * caller;
 };
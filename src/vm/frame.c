@@ -1,139 +1,635 @@
 #include "vm/frame.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "userprog/process.h"
+#include "vm/page.h"
+#include "vm/swap.h"
 
-int frame_number = 0;
+struct list frame_table;
 
-struct frame* find_free_frame(enum palloc_flags);
+/* One descriptor per user pool page, indexed by
+   palloc_user_page_idx(), so that finding the frame of a kernel
+   address is a subtraction and a shift. */
+static struct frame *frames;
+static size_t frame_cnt;
 
+/* Protects frame_table, frames[] and every frame's pin_cnt. */
+static struct lock frame_lock;
+
+bool vm_print_stats;
+
+static struct frame *find_frame (void *paddr);
+static void * frame_eviction (enum palloc_flags flag, struct thread *only);
+static bool take_page_lock (struct thread *proc, struct lock **taken);
+static void unmap_locked (struct frame *, struct page *);
+static bool release_locked (struct frame *, struct page *);
+static bool unshare_locked (struct frame *);
+static void adopt_locked (struct frame *, struct thread *, uint32_t *pd,
+                          struct page *);
+static void protect (uint32_t *pd, struct page *, void *paddr);
+
+/* Initializes the frame table.  Called at boot, before any user
+   process exists, because frame_sample_working_set() walks
+   frames[] from the timer interrupt. */
 void init_table()
 {
-  static bool init = true;
-  if (init)
-  {
-    list_init(&frame_table);
-    init = false;
-  }
+  size_t cnt = palloc_user_page_cnt ();
+  size_t i;
+
+  list_init(&frame_table);
+  lock_init(&frame_lock);
+  frames = calloc (cnt, sizeof *frames);
+  if (frames == NULL)
+    PANIC ("frame: cannot allocate frame table");
+  for (i = 0; i < cnt; i++)
+    frames[i].frame_number = i;
+  frame_cnt = cnt;
 }
 
-void* get_free_frame(enum palloc_flags flags, void* vaddr)
+/* Obtains a user frame for PAGE, evicting another one if the
+   user pool is exhausted.  A process at its resident_limit
+   replaces one of its own frames instead, so that it cannot push
+   other processes out of memory.  The frame is returned pinned;
+   the caller must unpin_frame() it once the mapping is
+   installed. */
+void* get_free_frame(enum palloc_flags flags, struct page *page)
 {
-  init_table();
-  
   if ((flags & PAL_USER) == 0)
   {
     return NULL;
   }
-  void * page_addr = palloc_get_page(flag);
+  struct thread *cur = process_current();
+  void * paddr = NULL;
+
+  lock_acquire (&frame_lock);
+  if (cur -> resident_limit != 0 && cur -> resident_cnt >= cur -> resident_limit)
+    paddr = frame_eviction(flags, cur);
+  if (paddr == NULL)
+    paddr = palloc_get_page(flags);
   if(paddr == NULL)
   {
-    paddr = frame_eviction(flag);
+    paddr = frame_eviction(flags, NULL);
   }
-  struct frame f;
-  f -> holder = thread_current()->tid;
+  if (paddr == NULL)
+  {
+    lock_release (&frame_lock);
+    return NULL;
+  }
+  struct frame *f = find_frame (paddr);
+  f -> holder = cur -> tid;
+  f -> owner = cur;
+  f -> owner -> resident_cnt++;
   f -> paddr = paddr;
-  f -> vaddr = vaddr;
+  f -> vaddr = page -> upage;
   f -> pagedir = thread_current() -> pagedir;
-  f -> writable = true;
+  f -> page = page;
+  f -> writable = page -> writable;
   f -> valid_bit = true;
-  list_push_back (&frame_list, &(f->elem));
-  frame_number++;
-  /*
-  struct frame* frame = find_free_frame(flags);
-  if (frame != NULL)
+  f -> pin_cnt = 1;
+  f -> share_cnt = 0;
+  f -> flip_page = NULL;
+  list_push_back (&frame_table, &(f->elem));
+  lock_release (&frame_lock);
+
+  return paddr;
+}
+
+void free_frame(void* target_paddr)
+{
+  lock_acquire (&frame_lock);
+  struct frame *f = find_frame (target_paddr);
+  if (f != NULL && f -> valid_bit)
   {
-      frame -> tid = thread_tid();
-      frame -> memory = palloc_get_page (flags);
-      // install_page (upage, frame -> memory, true);
-      return frame -> memory;
+    f -> valid_bit = false;
+    f -> owner -> resident_cnt--;
+    list_remove (&(f->elem));
+    palloc_free_page (target_paddr);
   }
+  lock_release (&frame_lock);
+}
 
-  void* memory = palloc_get_page(flags);
-  // install_page (upage, memory, true);
-  frame = malloc (sizeof(struct frame));
-  frame -> frame_number = frame_number;
-  frame -> memory = memory;
-  frame -> tid = thread_tid();
-  list_push_back (&frame_table, &frame->elem);
+/* Pins the frame that PD maps at UPAGE, so that it cannot be
+   evicted until unpin_frame().  Returns false if UPAGE is not
+   resident.  The lookup and the pin happen under frame_lock, so
+   a concurrent eviction either completes first (and we report
+   the page as absent) or does not pick this frame at all. */
+bool pin_frame (uint32_t *pd, const void *upage)
+{
+  bool success = false;
+
+  lock_acquire (&frame_lock);
+  void *paddr = pagedir_get_page (pd, upage);
+  if (paddr != NULL)
+  {
+    struct frame *f = find_frame (pg_round_down (paddr));
+    if (f != NULL && f -> valid_bit)
+    {
+      f -> pin_cnt++;
+      success = true;
+    }
+  }
+  lock_release (&frame_lock);
+  return success;
+}
 
-  
+void unpin_frame (void *paddr)
+{
+  lock_acquire (&frame_lock);
+  struct frame *f = find_frame (pg_round_down (paddr));
+  ASSERT (f != NULL && f -> valid_bit && f -> pin_cnt > 0);
+  f -> pin_cnt--;
+  lock_release (&frame_lock);
+}
 
-  return frame -> memory;
-  */
+/* Returns the descriptor for user pool page PADDR, or NULL if
+   PADDR is not a user page. */
+static struct frame *find_frame (void *paddr)
+{
+  if (paddr == NULL)
+    return NULL;
+  size_t idx = palloc_user_page_idx (paddr);
+  return idx < frame_cnt ? &frames[idx] : NULL;
 }
-/*
-struct frame* find_free_frame(enum palloc_flags flags)
+
+/* Picks the oldest unpinned frame, owned by ONLY if that is
+   non-null, writes it out if needed and hands its memory back for
+   reuse.  Returns NULL if there is no such frame.  Caller must
+   hold frame_lock, which is released while the frame is written
+   to swap, so that the rest of the system does not wait for the
+   disk.  Meanwhile the victim is pinned, and the page_locks of
+   the processes that map it are held, so that they block in the
+   page fault handler and in teardown until the pages are out. */
+static void * frame_eviction (enum palloc_flags flag, struct thread *only)
 {
-  if (list_empty(&frame_table))
-      return NULL;
+  struct list_elem *e;
+  struct frame * f = NULL;
+  struct lock *owner_lock = NULL, *flip_lock = NULL;
 
-  struct frame * now = list_entry(list_front(&frame_table), struct frame, elem);
-  while (now != NULL)
+  for (;;)
   {
-    if (now -> memory == NULL)
+    bool busy = false;
+
+    for (e = list_begin (&frame_table); e != list_end (&frame_table);
+         e = list_next (e))
     {
-      return now;
+      struct frame *candidate = list_entry (e, struct frame, elem);
+      if (candidate -> pin_cnt != 0
+          || (only != NULL && candidate -> owner != only))
+        continue;
+      if (!take_page_lock (candidate -> owner, &owner_lock))
+      {
+        busy = true;
+        continue;
+      }
+      if (candidate -> flip_page != NULL
+          && !take_page_lock (candidate -> flip_owner, &flip_lock))
+      {
+        if (owner_lock != NULL)
+          lock_release (owner_lock);
+        busy = true;
+        continue;
+      }
+      f = candidate;
+      break;
     }
+    if (f != NULL)
+      break;
+    if (!busy)
+      return NULL;
 
-    if (now -> elem.next != NULL)
-        now = list_entry(list_next(&(now->elem)), struct frame, elem);
-    else
-        break;
+    /* Only frames of processes that are paging right now are
+       left.  Waiting for their page_locks while holding our own
+       could deadlock, so give them a tick to finish. */
+    lock_release (&frame_lock);
+    timer_sleep (1);
+    lock_acquire (&frame_lock);
+  }
+
+  /* Unmap first so that the owner faults rather than writing to
+     the frame while it is being saved.  A pipe reader's mapping
+     gets a copy of its own in swap. */
+  struct page *page = f -> page;
+  struct page *flip_page = f -> flip_page;
+  void *paddr = f -> paddr;
+  bool dirty = pagedir_is_dirty (f -> pagedir, f -> vaddr);
+  f -> pin_cnt = 1;
+  pagedir_clear_page (f -> pagedir, f -> vaddr);
+  if (flip_page != NULL)
+    pagedir_clear_page (f -> flip_pd, flip_page -> upage);
+
+  lock_release (&frame_lock);
+  if (dirty || page -> file == NULL)
+    page -> swap_slot = swap_to_disk (paddr);
+  if (flip_page != NULL)
+    flip_page -> swap_slot = swap_to_disk (paddr);
+  lock_acquire (&frame_lock);
+
+  page -> valid_bit = false;
+  f -> owner -> evictions++;
+  f -> owner -> resident_cnt--;
+  if (flip_page != NULL)
+  {
+    flip_page -> valid_bit = false;
+    f -> flip_owner -> evictions++;
+    f -> flip_page = NULL;
   }
-  return NULL;
+  f -> pin_cnt = 0;
+  f -> valid_bit = false;
+  list_remove (&(f -> elem));
+  if (owner_lock != NULL)
+    lock_release (owner_lock);
+  if (flip_lock != NULL)
+    lock_release (flip_lock);
+
+  if (flag & PAL_ZERO)
+    memset (paddr, 0, PGSIZE);
+  return paddr;
 }
-*/
 
-void free_frame(void* target_paddr)
+/* Makes sure that the current thread holds the page_lock of
+   process PROC, without waiting for it.  Returns false if another
+   thread holds it.  Otherwise returns true and sets *TAKEN to the
+   lock if it was acquired here, to a null pointer if the current
+   thread already held it. */
+static bool take_page_lock (struct thread *proc, struct lock **taken)
 {
-    struct frame * now = list_entry(list_front(&frame_table), struct frame, elem);
-    while (now != NULL)
-    {
-        if (now -> paddr == target_paddr)
-        {
-          now -> valid_bit = false;
-          list_remove(&(f->elem));
-          palloc_free_page (paddr);
-          break;
-        }
-        if (now -> elem.next != NULL)
-            now = list_entry(list_next(&(now->elem)), struct frame, elem);
-        else
-            break;
-    }
+  struct lock *lock = &proc -> page_lock;
+
+  *taken = NULL;
+  if (lock_held_by_current_thread (lock))
+    return true;
+  if (!lock_try_acquire (lock))
+    return false;
+  *taken = lock;
+  return true;
 }
 
-void * frame_eviction (enum palloc_flags flag)
+/* Sets T's working_set to the number of its resident pages
+   referenced since the previous sample, and starts a new sample
+   by clearing their accessed bits.
+
+   Called from the timer interrupt, so it cannot take
+   frame_lock; it only reads frames[], which is never freed, and
+   the interrupted thread cannot be half way through releasing
+   one of T's frames unless it is T itself, in which case
+   valid_bit is cleared before the page directory goes away. */
+void frame_sample_working_set (struct thread *t)
 {
-  struct frame * f = list_entry (list_pop_front (&frame_list), struct frame, elem);
-  swap_to_disk (f);
-  pagedir_clear_page (f -> pagedir, f -> vaddr);
-  palloc_free_page (f -> paddr);
-  list_remove (&(f -> elem));
-  free(f);
-  return palloc_get_page(flag);
+  unsigned cnt = 0;
+  size_t i;
+
+  for (i = 0; i < frame_cnt; i++)
+  {
+    struct frame *f = &frames[i];
+    if (f -> valid_bit && f -> owner == t
+        && pagedir_is_accessed (f -> pagedir, f -> vaddr))
+    {
+      cnt++;
+      pagedir_set_accessed (f -> pagedir, f -> vaddr, false);
+    }
+  }
+  t -> working_set = cnt;
 }
 
+/* Returns the frame with FINDING_NO, its index in the user
+   pool, or NULL if that frame is not in use. */
 struct frame *
 number_to_frame (tid_t finding_no)
 {
-    printf("%s %d\n", "tid", thread_current ()->tid);
-  if (list_empty(&frame_table))
+  if (finding_no < 0 || (size_t) finding_no >= frame_cnt
+      || !frames[finding_no].valid_bit)
+    return NULL;
+  return &frames[finding_no];
+}
+
+/* Page flipping.
+
+   A frame has one primary mapping, the one its owner, pagedir,
+   vaddr and page members describe.  frame_lend() hands out a
+   reference to it, which a pipe holds until frame_return() or
+   frame_flip().  Each loan counts in share_cnt and pins the
+   frame.  While a frame is lent, pages that may be written are
+   mapped read-only and marked cow, and the first write to one
+   takes a private copy through frame_break_cow().
+
+   frame_flip() ends a loan by mapping the frame read-only, and
+   cow, at a page of the reader.  The frame keeps at most one such
+   mapping, in its flip_* members, which does not pin it: eviction
+   saves a copy for each mapping.  When the primary mapping goes
+   away, the reader's mapping takes its place, so the frame stays
+   evictable and counts against the reader.  A frame whose primary
+   mapping goes with neither is orphaned: it leaves frame_table and
+   is freed with its last loan. */
+
+/* Releases the frames of the CNT pages in PAGES, at most
+   FRAME_BATCH, of a process whose page directory PD is no longer
+   active.  Their mappings are left in PD for pagedir_destroy() to
+   discard.  Takes frame_lock once and hands the freed frames back
+   to the user pool in one go.  Pages that are not resident are
+   skipped. */
+void frame_unmap_batch (uint32_t *pd, struct page **pages, size_t cnt)
+{
+  void *freed[FRAME_BATCH];
+  size_t freed_cnt = 0;
+  size_t i;
+
+  ASSERT (cnt <= FRAME_BATCH);
+  lock_acquire (&frame_lock);
+  for (i = 0; i < cnt; i++)
+  {
+    struct page *page = pages[i];
+    void *paddr;
+
+    if (!page -> valid_bit)
+      continue;
+    paddr = pagedir_get_page (pd, page -> upage);
+    page -> valid_bit = false;
+    if (release_locked (find_frame (paddr), page))
+      freed[freed_cnt++] = paddr;
+  }
+  lock_release (&frame_lock);
+  palloc_free_batch (freed, freed_cnt);
+}
+
+/* Lends out the frame of PAGE, which is resident in the current
+   process, and returns it, or a null pointer if PAGE has no
+   frame.  PAGE stays mapped but copy-on-write. */
+void *frame_lend (struct page *page)
+{
+  uint32_t *pd = thread_current () -> pagedir;
+  void *paddr;
+  struct frame *f;
+
+  lock_acquire (&frame_lock);
+  paddr = pagedir_get_page (pd, page -> upage);
+  f = find_frame (paddr);
+  if (f == NULL || !f -> valid_bit)
+  {
+    lock_release (&frame_lock);
     return NULL;
-  struct frame * now = list_entry(list_front(&frame_table), struct frame, elem);
+  }
+  f -> share_cnt++;
+  f -> pin_cnt++;
+  if (page -> writable && !page -> cow)
+    protect (pd, page, paddr);
+  lock_release (&frame_lock);
+  return paddr;
+}
 
-  while (now != NULL)
+/* Gives back lent frame PADDR. */
+void frame_return (void *paddr)
+{
+  lock_acquire (&frame_lock);
+  if (unshare_locked (find_frame (paddr)))
+    palloc_free_page (paddr);
+  lock_release (&frame_lock);
+}
+
+/* Maps lent frame PADDR at PAGE, which must be writable, resident
+   and pinned in the current process, in place of PAGE's frame,
+   and ends the loan.  The caller's pin moves to the new frame, so
+   that unpinning the page later balances.  Returns false, and
+   leaves PADDR lent, if the frame is already mapped by another
+   reader. */
+bool frame_flip (struct page *page, void *paddr)
+{
+  uint32_t *pd = thread_current () -> pagedir;
+  struct frame *old, *new;
+
+  ASSERT (page -> writable);
+  lock_acquire (&frame_lock);
+  old = find_frame (pagedir_get_page (pd, page -> upage));
+  new = find_frame (paddr);
+  ASSERT (old != NULL && old -> pin_cnt > 0 && new != NULL);
+  if (new -> flip_page != NULL)
   {
-      printf("%s %p\n", "frame table address", now);
-    if (now -> frame_number == finding_no)
+    lock_release (&frame_lock);
+    return false;
+  }
+  new -> share_cnt--;
+  new -> pin_cnt--;
+  if (old != new)
+  {
+    old -> pin_cnt--;
+    new -> pin_cnt++;
+    pagedir_clear_page (pd, page -> upage);
+    unmap_locked (old, page);
+    pagedir_set_page (pd, page -> upage, paddr, false);
+    page -> cow = true;
+    if (new -> page == NULL)
+      adopt_locked (new, process_current (), pd, page);
+    else
     {
-      return now;
+      new -> flip_page = page;
+      new -> flip_owner = process_current ();
+      new -> flip_pd = pd;
     }
-    if (now == list_entry(list_end(&frame_table), struct frame, elem))
-      break;
-    now = list_entry(list_next(&(now->elem)), struct frame, elem);
   }
-  return NULL;
+  lock_release (&frame_lock);
+  return true;
+}
+
+/* Makes copy-on-write PAGE of the current process writable again,
+   copying its frame unless nobody else holds it.  Returns false
+   if no frame is free for the copy. */
+bool frame_break_cow (struct page *page)
+{
+  uint32_t *pd = thread_current () -> pagedir;
+  void *old, *new;
+  struct frame *f;
+
+  lock_acquire (&frame_lock);
+  old = pagedir_get_page (pd, page -> upage);
+  page -> cow = false;
+  if (old == NULL)
+  {
+    /* Evicted; it comes back writable. */
+    lock_release (&frame_lock);
+    return true;
+  }
+  f = find_frame (old);
+  if (f -> page == page && f -> share_cnt == 0 && f -> flip_page == NULL)
+  {
+    /* Nobody else holds it. */
+    bool dirty = pagedir_is_dirty (pd, page -> upage);
+    pagedir_clear_page (pd, page -> upage);
+    pagedir_set_page (pd, page -> upage, old, true);
+    pagedir_set_dirty (pd, page -> upage, dirty);
+    lock_release (&frame_lock);
+    return true;
+  }
+  /* Keep the frame from being evicted while we copy it. */
+  f -> pin_cnt++;
+  lock_release (&frame_lock);
+
+  new = get_free_frame (PAL_USER, page);
+  if (new != NULL)
+    memcpy (new, old, PGSIZE);
+
+  lock_acquire (&frame_lock);
+  f -> pin_cnt--;
+  if (new != NULL)
+  {
+    pagedir_clear_page (pd, page -> upage);
+    unmap_locked (f, page);
+    pagedir_set_page (pd, page -> upage, new, true);
+    pagedir_set_dirty (pd, page -> upage, true);
+  }
+  else
+    page -> cow = true;
+  lock_release (&frame_lock);
+
+  if (new == NULL)
+    return false;
+  unpin_frame (new);
+  return true;
+}
+
+/* Shared memory.
+
+   A frame of a shared memory segment (see shm.c) starts out
+   orphaned, with the segment's own reference as its one share,
+   and each process that maps it adds another.  Such frames stay
+   pinned, so they are never evicted, and are freed with the last
+   reference like any other orphan. */
+
+/* Allocates a zeroed orphan frame holding one reference, to be
+   dropped with frame_return(), or returns a null pointer if no
+   frame is free. */
+void *frame_alloc_shared (void)
+{
+  void *paddr;
+  struct frame *f;
+
+  lock_acquire (&frame_lock);
+  paddr = palloc_get_page (PAL_USER | PAL_ZERO);
+  if (paddr == NULL)
+    paddr = frame_eviction (PAL_USER | PAL_ZERO, NULL);
+  if (paddr == NULL)
+  {
+    lock_release (&frame_lock);
+    return NULL;
+  }
+  f = find_frame (paddr);
+  f -> holder = TID_ERROR;
+  f -> owner = NULL;
+  f -> paddr = paddr;
+  f -> vaddr = NULL;
+  f -> pagedir = NULL;
+  f -> page = NULL;
+  f -> writable = true;
+  f -> valid_bit = true;
+  f -> pin_cnt = 1;
+  f -> share_cnt = 1;
+  f -> flip_page = NULL;
+  lock_release (&frame_lock);
+  return paddr;
+}
+
+/* Adds a reference to shared frame PADDR for a new mapping,
+   which frame_unmap_batch() drops again. */
+void frame_share (void *paddr)
+{
+  lock_acquire (&frame_lock);
+  struct frame *f = find_frame (paddr);
+  ASSERT (f != NULL && f -> valid_bit && f -> page == NULL);
+  f -> share_cnt++;
+  f -> pin_cnt++;
+  lock_release (&frame_lock);
+}
+
+/* Drops PAGE's mapping of F, freeing F if nothing else holds it.
+   Caller must hold frame_lock. */
+static void unmap_locked (struct frame *f, struct page *page)
+{
+  if (release_locked (f, page))
+    palloc_free_page (f -> paddr);
+}
+
+/* Drops PAGE's mapping of F, which is F's primary mapping if
+   PAGE is F's page, a pipe reader's if it is F's flip_page, and a
+   shared memory one otherwise.  A reader's mapping left alone
+   becomes primary.  Returns true if F is no longer in use, in
+   which case the caller must free its memory.  Caller must hold
+   frame_lock. */
+static bool release_locked (struct frame *f, struct page *page)
+{
+  ASSERT (f != NULL && f -> valid_bit);
+  if (f -> flip_page != NULL && f -> flip_page == page)
+  {
+    f -> flip_page = NULL;
+    return false;
+  }
+  if (f -> page != page)
+    return unshare_locked (f);
+
+  f -> owner -> resident_cnt--;
+  list_remove (&f -> elem);
+  f -> owner = NULL;
+  f -> page = NULL;
+  f -> pagedir = NULL;
+  f -> vaddr = NULL;
+  if (f -> flip_page != NULL)
+  {
+    struct page *flip_page = f -> flip_page;
+    f -> flip_page = NULL;
+    adopt_locked (f, f -> flip_owner, f -> flip_pd, flip_page);
+    return false;
+  }
+  if (f -> share_cnt > 0)
+    return false;
+  f -> valid_bit = false;
+  return true;
+}
+
+/* Makes PAGE, mapped at F in OWNER's page directory PD, the
+   primary mapping of F, which has none.  F's contents are not
+   PAGE's file contents, so PAGE is marked dirty.  Caller must
+   hold frame_lock. */
+static void adopt_locked (struct frame *f, struct thread *owner,
+                          uint32_t *pd, struct page *page)
+{
+  ASSERT (f -> page == NULL);
+  f -> holder = owner -> tid;
+  f -> owner = owner;
+  f -> owner -> resident_cnt++;
+  f -> pagedir = pd;
+  f -> vaddr = page -> upage;
+  f -> page = page;
+  f -> writable = page -> writable;
+  list_push_back (&frame_table, &f -> elem);
+  pagedir_set_dirty (pd, page -> upage, true);
+}
+
+/* Drops one reference counted in F's share_cnt.  Returns true if
+   F was orphaned and that was the last, in which case the caller
+   must free its memory.  Caller must hold frame_lock. */
+static bool unshare_locked (struct frame *f)
+{
+  ASSERT (f != NULL && f -> share_cnt > 0 && f -> pin_cnt > 0);
+  f -> share_cnt--;
+  f -> pin_cnt--;
+  if (f -> share_cnt > 0 || f -> page != NULL)
+    return false;
+  f -> valid_bit = false;
+  return true;
+}
+
+/* Maps PAGE read-only at PADDR in PD, keeping its dirty bit, and
+   marks it copy-on-write. */
+static void protect (uint32_t *pd, struct page *page, void *paddr)
+{
+  bool dirty = pagedir_is_dirty (pd, page -> upage);
+  pagedir_clear_page (pd, page -> upage);
+  pagedir_set_page (pd, page -> upage, paddr, false);
+  pagedir_set_dirty (pd, page -> upage, dirty);
+  page -> cow = true;
 }
@@ -5,25 +5,49 @@
 #include "threads/thread.h"
 #include <list.h>
 
+struct page;
+
 struct frame
 {
-  int holder;
-  void * paddr;
-  void * vaddr;
-  unsigned int page_directory;
+  int holder;                 /* tid of the owning thread. */
+  struct thread * owner;      /* The owning thread itself. */
+  void * paddr;               /* Kernel virtual address of the frame. */
+  void * vaddr;               /* User page mapped onto the frame. */
+  uint32_t * pagedir;         /* Page directory holding the mapping. */
+  struct page * page;         /* Supplemental entry backed by the frame. */
   bool valid_bit;
   bool writable;
-  struct list_elem elem;
-  //
-  int frame_number;
-  void* memory;
+  int pin_cnt;                /* Never evicted while nonzero. */
+  int share_cnt;              /* Loans and shared memory mappings. */
+  struct page * flip_page;    /* Pipe reader's mapping, or NULL. */
+  struct thread * flip_owner; /* Process of FLIP_PAGE. */
+  uint32_t * flip_pd;         /* Page directory holding FLIP_PAGE. */
+  struct list_elem elem;      /* Eviction order in frame_table. */
+  int frame_number;           /* Index in the user pool. */
 };
 
-struct list frame_table;
+extern struct list frame_table;
+
+/* Most pages frame_unmap_batch() takes at once. */
+#define FRAME_BATCH 32
+
+/* Print paging statistics at process exit?
+   Controlled by kernel command-line option "-vmstats". */
+extern bool vm_print_stats;
 
 void init_table(void);  // initialize frame table
-void* get_free_frame(enum palloc_flags, void* upage); // find a free frame
+void* get_free_frame(enum palloc_flags, struct page *); // find a free frame
 void free_frame(void*);  // free an existing frame
 struct frame *number_to_frame (tid_t finding_no);  // find frame that has the frame number
+bool pin_frame (uint32_t *pd, const void *upage);  // pin the frame mapped at UPAGE
+void unpin_frame (void *paddr);  // drop one pin from an existing frame
+void frame_sample_working_set (struct thread *);  // refresh t->working_set
+void frame_unmap_batch (uint32_t *pd, struct page **, size_t cnt);  // drop the frames of exiting pages
+void *frame_lend (struct page *);  // lend PAGE's frame out copy-on-write
+void frame_return (void *paddr);  // give back a lent frame
+bool frame_flip (struct page *, void *paddr);  // map a lent frame at PAGE
+bool frame_break_cow (struct page *);  // give PAGE a private frame
+void *frame_alloc_shared (void);  // allocate a frame for shared memory
+void frame_share (void *paddr);  // add a mapping of a shared frame
 
 #endif /* vm/frame.h */
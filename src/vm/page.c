@@ -1,9 +1,13 @@
 #include <stdio.h>
 #include "vm/page.h"
 #include "vm/frame.h"
+#include "vm/swap.h"
+#include "userprog/pagedir.h"
 #include "userprog/process.h"
+#include "userprog/syscall.h"
 #include "threads/thread.h"
 #include "threads/malloc.h"
+#include "threads/synch.h"
 #include "threads/vaddr.h"
 #include <list.h>
 #include <string.h>
@@ -14,32 +18,105 @@ void init_page_table(struct list* page_table)
     list_init(page_table);
 }
 
-void destroy_page_table(struct list* page_table)
+static void release_pages (uint32_t *pd, struct page **, size_t cnt);
+
+/* Releases every page of an exiting process, whose page
+   directory PD is no longer active, and returns how many there
+   were.  Resident pages give back their frame and swapped pages
+   their swap slot, in one pass over PAGE_TABLE.  Frames go back
+   FRAME_BATCH at a time, and the page table entries are not
+   cleared one by one, since PD is about to be destroyed whole. */
+size_t destroy_page_table(struct list* page_table, uint32_t *pd)
 {
-    struct list_elem* e;
+    struct page *batch[FRAME_BATCH];
+    size_t cnt = 0, total = 0;
 
+    while (!list_empty (page_table))
+    {
+        struct list_elem *e = list_pop_front (page_table);
+        batch[cnt++] = list_entry (e, struct page, elem);
+        if (cnt == FRAME_BATCH)
+        {
+            release_pages (pd, batch, cnt);
+            total += cnt;
+            cnt = 0;
+        }
+    }
+    release_pages (pd, batch, cnt);
+    return total + cnt;
 }
 
+/* Releases the CNT pages in PAGES and frees them.  Their swap
+   slots are only known once their frames can no longer be
+   evicted. */
+static void release_pages (uint32_t *pd, struct page **pages, size_t cnt)
+{
+    size_t i;
+
+    frame_unmap_batch (pd, pages, cnt);
+    for (i = 0; i < cnt; i++)
+    {
+        swap_free (pages[i] -> swap_slot);
+        free (pages[i]);
+    }
+}
+
+/* Loads PAGE of the current process into a free frame and maps
+   it, unless another thread of the process did so first.  Caller
+   must hold the process's page_lock. */
 bool load_page(struct page* page)
 {
     if(!page)
         return false;
-    // int frame_number = get_free_frame_number(PAL_USER, page);
-    // uint8_t* kpage = number_to_frame(frame_number);
+    if (pagedir_get_page (thread_current () -> pagedir, page -> upage))
+        return true;
     uint8_t* kpage = get_free_frame(PAL_USER, page);
-    // uint8_t* kpage = palloc_get_page (PAL_USER);
     if (kpage == NULL)
         return false;
 
-    // page -> frame_number = frame_number;
+    /* A kernel fault may arrive with file_lock already held;
+       pin_user_buffer() exists so that this does not happen on
+       the read/write paths.  Otherwise file_lock comes before
+       page_lock, so wait for it with page_lock released and then
+       see whether a sibling thread loaded PAGE meanwhile. */
+    bool take_file = (page -> swap_slot == SWAP_NONE
+                      && !lock_held_by_current_thread (&file_lock));
+    if (take_file && !lock_try_acquire (&file_lock))
+    {
+        struct lock *page_lock = &process_current () -> page_lock;
+        lock_release (page_lock);
+        lock_acquire (&file_lock);
+        lock_acquire (page_lock);
+        if (pagedir_get_page (thread_current () -> pagedir, page -> upage))
+        {
+            lock_release (&file_lock);
+            free_frame (kpage);
+            return true;
+        }
+    }
 
-    // load this page
-    if (file_read (page -> file, kpage, page -> read_bytes) != (int) page -> read_bytes)
+    bool from_swap = page -> swap_slot != SWAP_NONE;
+    if (from_swap)
     {
-        // free_frame(kpage);
-        return false;
+        swap_from_disk (page -> swap_slot, kpage);
+        page -> swap_slot = SWAP_NONE;
+        process_current () -> swap_ins++;
+    }
+    else
+    {
+        off_t bytes = file_read_at (page -> file, kpage, page -> read_bytes,
+                                    page -> offset);
+        if (bytes != (int) page -> read_bytes)
+        {
+            if (take_file)
+                lock_release (&file_lock);
+            free_frame (kpage);
+            return false;
+        }
+        memset (kpage + page -> read_bytes, 0, page -> zero_bytes);
     }
-    memset (kpage + page -> read_bytes, 0, page -> zero_bytes);
+    if (take_file)
+        lock_release (&file_lock);
 
     // add the page to the process's address space
     if (!install_page (page -> upage, kpage, page -> writable))
@@ -47,16 +124,26 @@ bool load_page(struct page* page)
         free_frame (kpage);
         return false;
     }
+    /* Contents that came back from swap are not in the file any
+       more, so they must go back to swap if evicted again. */
+    if (from_swap)
+        pagedir_set_dirty (thread_current () -> pagedir, page -> upage, true);
+    page -> valid_bit = true;
+    page -> cow = false;
+    unpin_frame (kpage);
 
     return true;
 }
 
+/* Returns the current process's page that contains UPAGE, or a
+   null pointer if there is none.  Once the process may have
+   more than one thread, caller must hold its page_lock. */
 struct page* find_page(void* upage)
 {
     struct page temp;
     temp.upage = pg_round_down(upage);
 
-    struct thread* t = thread_current();
+    struct thread* t = process_current();
 
     if (list_empty(&t -> page_table))
         return NULL;
@@ -69,7 +156,7 @@ struct page* find_page(void* upage)
         return now;
       }
 
-      if (now -> elem.next != NULL)
+      if (list_next (&now -> elem) != list_end (&t -> page_table))
         now = list_entry(list_next(&(now->elem)), struct page, elem);
       else
         break;
@@ -78,6 +165,9 @@ struct page* find_page(void* upage)
     return NULL;
 }
 
+/* Maps a new zeroed stack page at PTR in the current process.
+   Once the process may have more than one thread, caller must
+   hold its page_lock. */
 bool grow_stack (void * ptr)
 {
     struct page * expage = malloc(sizeof(struct page));
@@ -85,34 +175,135 @@ bool grow_stack (void * ptr)
         return false;
     expage -> upage = pg_round_down(ptr);
     expage -> writable = true;
-    // expage -> frame_number = get_free_frame_number(PAL_USER, expage -> upage);
-    // if(expage -> frame_number == -1)
-    // {
-    //     free(expage);
-    //     return false;
-    // }
-
-    // void* exframe = number_to_frame (expage -> frame_number);
-    printf("%s\n", "before");
-    void* exframe = get_free_frame(PAL_USER, expage -> upage);
-    printf("%s\n", "after");
+    expage -> valid_bit = true;
+    expage -> file = NULL;
+    expage -> swap_slot = SWAP_NONE;
+    expage -> cow = false;
+    expage -> shared = false;
+
+    void* exframe = get_free_frame(PAL_USER | PAL_ZERO, expage);
     if (!exframe)
     {
-        printf("%s\n", "1");
         free(expage);
-        printf("%s\n", "2");
         return false;
     }
 
-    printf("%s\n", "3");
     if (!install_page(expage -> upage, exframe, expage -> writable))
     {
-        printf("%s\n", "4");
         free(expage);
         free_frame (exframe);
         return false;
     }
-    printf("%s\n", "4");
-    list_push_front (&(thread_current()->page_table), &expage->elem);
+    list_push_front (&(process_current()->page_table), &expage->elem);
+    unpin_frame (exframe);
     return true;
 }
+
+static void unpin_range (uint8_t *start, uint8_t *end);
+
+/* Makes every page of the user buffer [BUFFER, BUFFER + SIZE)
+   resident and pins its frame, faulting pages in or growing the
+   stack as needed.  If WRITE, the kernel is about to store into
+   the buffer, so every page must be writable.  Callers do this
+   before taking file_lock so that the file system never faults
+   on a user buffer, and must undo it with unpin_user_buffer().
+   Returns false, with nothing left pinned, if some page of the
+   buffer is not valid user memory. */
+bool pin_user_buffer (const void *buffer, size_t size, bool write)
+{
+    struct thread *t = thread_current ();
+    struct lock *page_lock = &process_current () -> page_lock;
+    uint8_t *start = pg_round_down (buffer);
+    uint8_t *end = (uint8_t *) buffer + size;
+    uint8_t *upage;
+
+    if (size == 0)
+        return true;
+    if (!in_valid_range (buffer) || !is_user_vaddr (end - 1) || end < start)
+        return false;
+
+    lock_acquire (page_lock);
+    for (upage = start; upage < end; upage += PGSIZE)
+    {
+        struct page *page = find_page (upage);
+
+        /* Untouched pages of a large stack object. */
+        if (page == NULL && upage >= (uint8_t *) t -> esp - 32 - PGSIZE)
+        {
+            if (!grow_stack (upage))
+                break;
+            page = find_page (upage);
+        }
+        if (page == NULL || (write && !page -> writable))
+            break;
+        /* Writing through the kernel would fault on it later. */
+        if (write && page -> cow && !frame_break_cow (page))
+            break;
+        while (!pin_frame (t -> pagedir, upage))
+            if (!load_page (page))
+                goto fail;
+    }
+    if (upage >= end)
+    {
+        lock_release (page_lock);
+        return true;
+    }
+
+ fail:
+    lock_release (page_lock);
+    unpin_range (start, upage);
+    return false;
+}
+
+/* Lends the frame of the current process's page UPAGE, which
+   must be pinned, for page flipping (see frame.c) and returns
+   it, or returns a null pointer if UPAGE cannot be lent. */
+void *page_lend (const void *upage)
+{
+    struct lock *page_lock = &process_current () -> page_lock;
+    void *kpage = NULL;
+
+    lock_acquire (page_lock);
+    struct page *page = find_page ((void *) upage);
+    if (page != NULL && page -> valid_bit && !page -> shared)
+        kpage = frame_lend (page);
+    lock_release (page_lock);
+    return kpage;
+}
+
+/* Maps lent frame KPAGE at the current process's page UPAGE,
+   which must be pinned, in place of its own frame.  Returns
+   false, and leaves KPAGE lent, if UPAGE is not writable or is
+   shared memory, whose frame other processes see, or if another
+   reader already maps KPAGE. */
+bool page_flip (void *upage, void *kpage)
+{
+    struct lock *page_lock = &process_current () -> page_lock;
+    bool success = false;
+
+    lock_acquire (page_lock);
+    struct page *page = find_page (upage);
+    if (page != NULL && page -> writable && page -> valid_bit
+        && !page -> shared)
+        success = frame_flip (page, kpage);
+    lock_release (page_lock);
+    return success;
+}
+
+/* Drops the pins taken by pin_user_buffer (BUFFER, SIZE). */
+void unpin_user_buffer (const void *buffer, size_t size)
+{
+    if (size == 0)
+        return;
+    unpin_range (pg_round_down (buffer), (uint8_t *) buffer + size);
+}
+
+/* Unpins the frame of every page in [START, END). */
+static void unpin_range (uint8_t *start, uint8_t *end)
+{
+    struct thread *t = thread_current ();
+    uint8_t *upage;
+
+    for (upage = start; upage < end; upage += PGSIZE)
+        unpin_frame (pagedir_get_page (t -> pagedir, upage));
+}
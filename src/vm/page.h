@@ -4,33 +4,32 @@
 #include "filesys/off_t.h"
 #include "threads/palloc.h"
 #include <list.h>
+#include <stdint.h>
 
 struct page
 {
-  //
-  int holder;
-  void * vaddr
-  struct frame * connected_frame;
-  bool writable
-  struct file * file;
+  void* upage;                /* User virtual page. */
+  bool writable;
+  bool valid_bit;             /* True while the page sits in a frame. */
+  struct file* file;          /* Backing executable, or NULL. */
   off_t offset;
-  size_t page_size;
-  //struct hash_elem page_elem;
-  //
-  int table_number;
-  int frame_number;
-  bool valid_bit;
-  struct file* file;
   size_t read_bytes;
   size_t zero_bytes;
-  void* upage;
+  size_t swap_slot;           /* SWAP_NONE unless the page is swapped. */
+  bool cow;                   /* Mapped read-only until written. */
+  bool shared;                /* Maps a shared memory frame. */
+  int table_number;
   struct list_elem elem;
 };
 
 void init_page_table(struct list*);
-void destroy_page_table(struct list*);
+size_t destroy_page_table(struct list*, uint32_t *pd);
 bool load_page(struct page* page);
 struct page* find_page(void* upage);
 bool grow_stack (void * ptr);
+bool pin_user_buffer (const void *buffer, size_t size, bool write);
+void unpin_user_buffer (const void *buffer, size_t size);
+void *page_lend (const void *upage);
+bool page_flip (void *upage, void *kpage);
 
 #endif /* vm/page.h */
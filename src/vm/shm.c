@@ -0,0 +1,245 @@
+#include "vm/shm.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "userprog/process.h"
+#include "vm/frame.h"
+#include "vm/page.h"
+#include "vm/swap.h"
+
+/* Named shared memory segments.
+
+   A segment is a fixed set of zeroed frames that belong to no
+   process.  shm_map() maps all of them, writable, into the
+   calling process; every mapping holds a reference to each frame
+   (see frame.c), so that frames outlive the segment for as long
+   as they are mapped, and mappings go away with the process.
+
+   Processes refer to segments through handles, which, like open
+   files in userprog/syscall.c, are kept in one list and told
+   apart by their owner.  A segment's name is dropped, and its own
+   references to its frames released, when the last handle on it
+   is closed at process exit. */
+struct shm
+  {
+    struct list_elem elem;      /* Element in shm_list. */
+    char name[SHM_NAME_MAX + 1]; /* Name given to shm_open(). */
+    int ref_cnt;                /* Handles open on the segment. */
+    size_t page_cnt;            /* Number of elements in FRAMES. */
+    void *frames[];             /* Kernel addresses of the frames. */
+  };
+
+/* A process's handle on a segment. */
+struct shm_handle
+  {
+    struct list_elem elem;      /* Element in handle_list. */
+    int id;                     /* Returned by shm_open(). */
+    struct shm *shm;            /* The segment. */
+    struct thread *owner;       /* Process holding the handle. */
+  };
+
+static struct list shm_list;    /* All named segments. */
+static struct list handle_list; /* Handles of all processes. */
+static struct lock shm_lock;    /* Protects both lists. */
+
+static struct shm *create (const char *name, size_t page_cnt);
+static void release (struct shm *);
+static struct shm_handle *lookup_handle (struct thread *, int id);
+
+/* Initializes the segment lists. */
+void shm_init (void)
+{
+  list_init (&shm_list);
+  list_init (&handle_list);
+  lock_init (&shm_lock);
+}
+
+/* Opens the segment called NAME, creating it with SIZE bytes,
+   rounded up to whole pages, if there is none.  An existing
+   segment must be at least SIZE bytes long.  Returns a handle for
+   shm_map(), or -1 on failure. */
+int shm_open (const char *name, size_t size)
+{
+  struct thread *cur = process_current ();
+  size_t page_cnt = DIV_ROUND_UP (size, PGSIZE);
+  struct shm_handle *h;
+  struct shm *shm = NULL;
+  struct list_elem *e;
+
+  if (strlen (name) > SHM_NAME_MAX || page_cnt == 0
+      || page_cnt > SHM_PAGES_MAX)
+    return -1;
+  h = malloc (sizeof *h);
+  if (h == NULL)
+    return -1;
+
+  lock_acquire (&shm_lock);
+  for (e = list_begin (&shm_list); e != list_end (&shm_list);
+       e = list_next (e))
+    if (!strcmp (list_entry (e, struct shm, elem)->name, name))
+      {
+        shm = list_entry (e, struct shm, elem);
+        break;
+      }
+  if (shm == NULL)
+    shm = create (name, page_cnt);
+  if (shm == NULL || shm->page_cnt < page_cnt)
+    {
+      lock_release (&shm_lock);
+      free (h);
+      return -1;
+    }
+  shm->ref_cnt++;
+
+  h->id = 0;
+  for (e = list_begin (&handle_list); e != list_end (&handle_list);
+       e = list_next (e))
+    {
+      struct shm_handle *other = list_entry (e, struct shm_handle, elem);
+      if (other->owner == cur && other->id >= h->id)
+        h->id = other->id + 1;
+    }
+  h->shm = shm;
+  h->owner = cur;
+  list_push_back (&handle_list, &h->elem);
+  lock_release (&shm_lock);
+  return h->id;
+}
+
+/* Maps the segment with handle SHMID into the current process at
+   ADDR, which must be page-aligned and followed by enough unused
+   user address space.  Returns ADDR, or a null pointer on
+   failure. */
+void *shm_map (int shmid, void *addr)
+{
+  struct thread *cur = process_current ();
+  struct shm_handle *h;
+  uint8_t *upage;
+  size_t i;
+
+  lock_acquire (&shm_lock);
+  h = lookup_handle (cur, shmid);
+  if (h == NULL || pg_ofs (addr) != 0 || !in_valid_range (addr)
+      || !is_user_vaddr ((uint8_t *) addr + h->shm->page_cnt * PGSIZE - 1))
+    {
+      lock_release (&shm_lock);
+      return NULL;
+    }
+  lock_acquire (&cur->page_lock);
+  for (i = 0, upage = addr; i < h->shm->page_cnt; i++, upage += PGSIZE)
+    if (find_page (upage) != NULL
+        || pagedir_get_page (cur->pagedir, upage) != NULL)
+      {
+        lock_release (&cur->page_lock);
+        lock_release (&shm_lock);
+        return NULL;
+      }
+
+  for (i = 0, upage = addr; i < h->shm->page_cnt; i++, upage += PGSIZE)
+    {
+      struct page *page = malloc (sizeof *page);
+      if (page == NULL)
+        break;
+      page->upage = upage;
+      page->writable = true;
+      page->valid_bit = true;
+      page->file = NULL;
+      page->swap_slot = SWAP_NONE;
+      page->cow = false;
+      page->shared = true;
+      if (!install_page (upage, h->shm->frames[i], true))
+        {
+          free (page);
+          break;
+        }
+      frame_share (h->shm->frames[i]);
+      list_push_front (&cur->page_table, &page->elem);
+    }
+  lock_release (&cur->page_lock);
+  lock_release (&shm_lock);
+
+  /* Pages mapped before a failure are released with the rest of
+     the address space. */
+  return i == h->shm->page_cnt ? addr : NULL;
+}
+
+/* Closes every segment handle T holds.  Called as T exits. */
+void shm_close_all (struct thread *t)
+{
+  struct list_elem *e, *next;
+
+  lock_acquire (&shm_lock);
+  for (e = list_begin (&handle_list); e != list_end (&handle_list);
+       e = next)
+    {
+      struct shm_handle *h = list_entry (e, struct shm_handle, elem);
+      next = list_next (e);
+      if (h->owner == t)
+        {
+          list_remove (&h->elem);
+          if (--h->shm->ref_cnt == 0)
+            {
+              list_remove (&h->shm->elem);
+              release (h->shm);
+            }
+          free (h);
+        }
+    }
+  lock_release (&shm_lock);
+}
+
+/* Creates segment NAME with PAGE_CNT zeroed frames and adds it
+   to shm_list, or returns a null pointer if memory is short.
+   Caller must hold shm_lock. */
+static struct shm *create (const char *name, size_t page_cnt)
+{
+  struct shm *shm = malloc (sizeof *shm + page_cnt * sizeof *shm->frames);
+  if (shm == NULL)
+    return NULL;
+  strlcpy (shm->name, name, sizeof shm->name);
+  shm->ref_cnt = 0;
+  for (shm->page_cnt = 0; shm->page_cnt < page_cnt; shm->page_cnt++)
+    {
+      shm->frames[shm->page_cnt] = frame_alloc_shared ();
+      if (shm->frames[shm->page_cnt] == NULL)
+        {
+          release (shm);
+          return NULL;
+        }
+    }
+  list_push_back (&shm_list, &shm->elem);
+  return shm;
+}
+
+/* Releases SHM's references to its frames and frees it.  SHM
+   must not be in shm_list.  Caller must hold shm_lock. */
+static void release (struct shm *shm)
+{
+  size_t i;
+
+  for (i = 0; i < shm->page_cnt; i++)
+    frame_return (shm->frames[i]);
+  free (shm);
+}
+
+/* Returns T's segment handle ID, or a null pointer if it has
+   none.  Caller must hold shm_lock. */
+static struct shm_handle *lookup_handle (struct thread *t, int id)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&handle_list); e != list_end (&handle_list);
+       e = list_next (e))
+    {
+      struct shm_handle *h = list_entry (e, struct shm_handle, elem);
+      if (h->owner == t && h->id == id)
+        return h;
+    }
+  return NULL;
+}
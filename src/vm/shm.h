@@ -0,0 +1,19 @@
+#ifndef VM_SHM_H
+#define VM_SHM_H
+
+#include <stddef.h>
+
+struct thread;
+
+/* Longest shared memory segment name. */
+#define SHM_NAME_MAX 14
+
+/* Most pages in one segment. */
+#define SHM_PAGES_MAX 64
+
+void shm_init (void);
+int shm_open (const char *name, size_t size);
+void *shm_map (int shmid, void *addr);
+void shm_close_all (struct thread *);
+
+#endif /* vm/shm.h */
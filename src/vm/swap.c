@@ -1 +1,309 @@
 #include "vm/swap.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/block.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Number of block sectors that hold one page. */
+#define SECTORS_PER_PAGE (PGSIZE / BLOCK_SECTOR_SIZE)
+
+static struct block *swap_block;   /* The BLOCK_SWAP device. */
+static struct bitmap *swap_map;    /* Used slots, one bit per page. */
+static struct lock swap_lock;      /* Protects everything below. */
+
+/* Compressed in-memory tier.
+
+   With -zswap=PAGES, evicted pages are first compressed into at
+   most PAGES pages' worth of kernel heap, and only go to the swap
+   device once that budget is spent or a page does not compress.
+   A page that is one 32-bit word repeated (typically all zeros)
+   takes no heap at all.  Other pages are packed with PackBits
+   run-length coding and kept only if that saves a quarter of the
+   page.
+
+   Slots in the tier are returned to callers with ZSWAP_BIT set,
+   so they share one namespace with device slots. */
+#define ZSWAP_BIT ((size_t) 1 << 31)
+#define ZSWAP_MAX_SIZE (PGSIZE - PGSIZE / 4)
+
+size_t zswap_pages;
+
+struct zslot
+  {
+    uint8_t *data;                 /* Packed page, NULL for a pattern. */
+    uint32_t pattern;              /* Repeated word if DATA is NULL. */
+    size_t size;                   /* Bytes at DATA. */
+  };
+
+static struct zslot *zslots;       /* Tier slots. */
+static struct bitmap *zslot_map;   /* Used tier slots. */
+static size_t zswap_bytes;         /* Heap bytes held by the tier. */
+static uint8_t *zswap_buf;         /* Scratch space for packing. */
+
+/* Statistics. */
+static long long zswap_stores;     /* Pages kept in the tier. */
+static long long zswap_stored_bytes; /* Their packed size. */
+static long long zswap_hits;       /* Swap-ins served by the tier. */
+static long long disk_reads;       /* Swap-ins served by the device. */
+
+static bool zswap_store (const void *kpage, size_t *slot);
+static void zswap_load (size_t idx, void *kpage);
+static void zswap_free (size_t idx);
+static size_t pack (const uint8_t *src, uint8_t *dst, size_t max);
+static void unpack (const uint8_t *src, size_t size, uint8_t *dst);
+
+/* Sets up the swap slot map.  Leaves swap disabled if no swap
+   device was found. */
+void swap_init (void)
+{
+  lock_init (&swap_lock);
+
+  if (zswap_pages > 0)
+    {
+      /* Patterned pages are free, so allow for more slots than
+         the budget could hold in packed pages. */
+      size_t slot_cnt = zswap_pages * 8;
+      zslots = calloc (slot_cnt, sizeof *zslots);
+      zslot_map = bitmap_create (slot_cnt);
+      zswap_buf = malloc (PGSIZE);
+      if (zslots == NULL || zslot_map == NULL || zswap_buf == NULL)
+        PANIC ("swap: cannot allocate compressed tier");
+    }
+
+  swap_block = block_get_role (BLOCK_SWAP);
+  if (swap_block == NULL)
+    return;
+  swap_map = bitmap_create (block_size (swap_block) / SECTORS_PER_PAGE);
+  if (swap_map == NULL)
+    PANIC ("swap: cannot allocate slot map");
+}
+
+/* Writes the page at KPAGE to a free swap slot and returns the
+   slot index.  Panics if swap is full or missing. */
+size_t swap_to_disk (const void *kpage)
+{
+  size_t slot;
+  int i;
+
+  lock_acquire (&swap_lock);
+  if (zslots != NULL && zswap_store (kpage, &slot))
+    {
+      lock_release (&swap_lock);
+      return slot;
+    }
+  if (swap_map == NULL)
+    PANIC ("swap: no swap device");
+  slot = bitmap_scan_and_flip (swap_map, 0, 1, false);
+  lock_release (&swap_lock);
+  if (slot == BITMAP_ERROR)
+    PANIC ("swap: out of slots");
+
+  for (i = 0; i < SECTORS_PER_PAGE; i++)
+    block_write (swap_block, slot * SECTORS_PER_PAGE + i,
+                 (const uint8_t *) kpage + i * BLOCK_SECTOR_SIZE);
+  return slot;
+}
+
+/* Reads swap slot SLOT into KPAGE and releases the slot. */
+void swap_from_disk (size_t slot, void *kpage)
+{
+  int i;
+
+  ASSERT (slot != SWAP_NONE);
+  if (slot & ZSWAP_BIT)
+    {
+      lock_acquire (&swap_lock);
+      zswap_load (slot & ~ZSWAP_BIT, kpage);
+      zswap_hits++;
+      lock_release (&swap_lock);
+      swap_free (slot);
+      return;
+    }
+
+  for (i = 0; i < SECTORS_PER_PAGE; i++)
+    block_read (swap_block, slot * SECTORS_PER_PAGE + i,
+                (uint8_t *) kpage + i * BLOCK_SECTOR_SIZE);
+  lock_acquire (&swap_lock);
+  disk_reads++;
+  lock_release (&swap_lock);
+  swap_free (slot);
+}
+
+/* Releases swap slot SLOT without reading it. */
+void swap_free (size_t slot)
+{
+  if (slot == SWAP_NONE)
+    return;
+  lock_acquire (&swap_lock);
+  if (slot & ZSWAP_BIT)
+    zswap_free (slot & ~ZSWAP_BIT);
+  else
+    bitmap_reset (swap_map, slot);
+  lock_release (&swap_lock);
+}
+
+/* Prints compressed tier statistics. */
+void swap_print_stats (void)
+{
+  long long reads = zswap_hits + disk_reads;
+
+  if (zslots == NULL)
+    return;
+  printf ("Swap: %lld pages compressed to %lld bytes (%lld%% of original), "
+          "%lld of %lld swap-ins from memory\n",
+          zswap_stores, zswap_stored_bytes,
+          zswap_stores > 0 ? zswap_stored_bytes * 100 / (zswap_stores * PGSIZE)
+                           : 0,
+          zswap_hits, reads);
+}
+
+/* Tries to keep KPAGE in the compressed tier, storing its slot in
+   *SLOT.  Returns false if the page should go to the device.
+   Caller must hold swap_lock. */
+static bool zswap_store (const void *kpage, size_t *slot)
+{
+  const uint32_t *words = kpage;
+  struct zslot *z;
+  size_t idx, size, i;
+
+  idx = bitmap_scan (zslot_map, 0, 1, false);
+  if (idx == BITMAP_ERROR)
+    return false;
+  z = &zslots[idx];
+
+  for (i = 1; i < PGSIZE / sizeof *words; i++)
+    if (words[i] != words[0])
+      break;
+  if (i == PGSIZE / sizeof *words)
+    {
+      z->data = NULL;
+      z->pattern = words[0];
+      z->size = 0;
+    }
+  else
+    {
+      size = pack (kpage, zswap_buf, ZSWAP_MAX_SIZE);
+      if (size == 0 || zswap_bytes + size > zswap_pages * PGSIZE)
+        return false;
+      z->data = malloc (size);
+      if (z->data == NULL)
+        return false;
+      memcpy (z->data, zswap_buf, size);
+      z->size = size;
+      zswap_bytes += size;
+    }
+
+  bitmap_mark (zslot_map, idx);
+  zswap_stores++;
+  zswap_stored_bytes += z->size;
+  *slot = idx | ZSWAP_BIT;
+  return true;
+}
+
+/* Restores tier slot IDX into KPAGE.  Caller must hold
+   swap_lock. */
+static void zswap_load (size_t idx, void *kpage)
+{
+  struct zslot *z = &zslots[idx];
+
+  ASSERT (bitmap_test (zslot_map, idx));
+  if (z->data == NULL)
+    {
+      uint32_t *words = kpage;
+      size_t i;
+
+      for (i = 0; i < PGSIZE / sizeof *words; i++)
+        words[i] = z->pattern;
+    }
+  else
+    unpack (z->data, z->size, kpage);
+}
+
+/* Releases tier slot IDX.  Caller must hold swap_lock. */
+static void zswap_free (size_t idx)
+{
+  struct zslot *z = &zslots[idx];
+
+  ASSERT (bitmap_test (zslot_map, idx));
+  if (z->data != NULL)
+    {
+      zswap_bytes -= z->size;
+      free (z->data);
+      z->data = NULL;
+    }
+  bitmap_reset (zslot_map, idx);
+}
+
+/* Packs the page at SRC into DST with PackBits coding: a control
+   byte C < 128 is followed by C + 1 literal bytes, and C >= 128
+   is followed by one byte to be repeated 257 - C times.  Returns
+   the packed size, or 0 if it would exceed MAX bytes. */
+static size_t pack (const uint8_t *src, uint8_t *dst, size_t max)
+{
+  size_t in = 0, out = 0;
+
+  while (in < PGSIZE)
+    {
+      size_t run = 1;
+
+      while (in + run < PGSIZE && run < 128 && src[in + run] == src[in])
+        run++;
+      if (run >= 3)
+        {
+          if (out + 2 > max)
+            return 0;
+          dst[out++] = 257 - run;
+          dst[out++] = src[in];
+          in += run;
+        }
+      else
+        {
+          /* Gather literals up to the next run of three. */
+          size_t lit = 0;
+
+          while (in + lit < PGSIZE && lit < 128
+                 && !(in + lit + 2 < PGSIZE
+                      && src[in + lit] == src[in + lit + 1]
+                      && src[in + lit] == src[in + lit + 2]))
+            lit++;
+          if (lit == 0)
+            lit = 1;
+          if (out + 1 + lit > max)
+            return 0;
+          dst[out++] = lit - 1;
+          memcpy (dst + out, src + in, lit);
+          out += lit;
+          in += lit;
+        }
+    }
+  return out;
+}
+
+/* Unpacks SIZE bytes of PackBits data at SRC into the page at
+   DST. */
+static void unpack (const uint8_t *src, size_t size, uint8_t *dst)
+{
+  size_t in = 0, out = 0;
+
+  while (in < size)
+    {
+      uint8_t c = src[in++];
+      if (c < 128)
+        {
+          memcpy (dst + out, src + in, c + 1);
+          in += c + 1;
+          out += c + 1;
+        }
+      else
+        {
+          memset (dst + out, src[in++], 257 - c);
+          out += 257 - c;
+        }
+    }
+  ASSERT (out == PGSIZE);
+}
@@ -1,4 +1,19 @@
 #ifndef VM_SWAP_H
 #define VM_SWAP_H
 
+#include <stddef.h>
+
+/* Swap slot index meaning "not in swap". */
+#define SWAP_NONE ((size_t) -1)
+
+/* Page budget of the compressed in-memory tier, 0 to disable.
+   Controlled by kernel command-line option "-zswap=PAGES". */
+extern size_t zswap_pages;
+
+void swap_init (void);
+size_t swap_to_disk (const void *kpage);
+void swap_from_disk (size_t slot, void *kpage);
+void swap_free (size_t slot);
+void swap_print_stats (void);
+
 #endif /* vm/swap.h */